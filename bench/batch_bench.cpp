@@ -0,0 +1,82 @@
+#include "yaml-cpp/yaml.h"
+
+#include "batch_playout.h"
+#include "game.h"
+#include "random.h"
+
+#include <chrono>
+#include <iostream>
+
+namespace
+{
+    struct Args
+    {
+        std::string tilesYamlPath;
+        int games = 256;
+    };
+
+    Args parseArgs(int argc, char **argv)
+    {
+        if (argc < 2 || argc > 3)
+        {
+            std::cout << "Error: did not pass the expected number of args." << std::endl;
+            std::cout << "Usage: " << argv[0] << " path-to-tiles-yaml [games-in-batch]" << std::endl;
+            std::exit(1);
+        }
+        Args args;
+        args.tilesYamlPath = argv[1];
+        if (argc > 2)
+        {
+            args.games = std::stoi(argv[2]);
+        }
+        return args;
+    }
+
+    template <class PlayAllGames>
+    void measure(const std::string &name, PlayAllGames playAllGames)
+    {
+        using Clock = std::chrono::steady_clock;
+        const auto start = Clock::now();
+        const long long moves = playAllGames();
+        const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        std::cout << name << ": " << moves / seconds << " moves/s on one core, " << moves << " moves in "
+                  << seconds << " s" << std::endl;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    Args args = parseArgs(argc, argv);
+    YAML::Node rootNode = YAML::LoadFile(args.tilesYamlPath);
+    const auto compatibility = Game::loadCompatibility(rootNode);
+    setSeed(1);
+
+    // Games are set up before the clock starts, so that only playing is measured.
+    std::vector<Game> games;
+    games.reserve(args.games);
+    for (int k = 0; k < args.games; k++)
+    {
+        games.push_back(Game::fromYaml(rootNode, compatibility));
+    }
+    measure("Game::nextMoves x" + std::to_string(args.games), [&games]
+            {
+                long long moves = 0;
+                for (Game &game : games)
+                {
+                    for (std::vector<Move> nextMoves = game.nextMoves(); !nextMoves.empty(); nextMoves = game.nextMoves())
+                    {
+                        game.makeMove(nextMoves[getRandom(std::uniform_int_distribution<int>(0, nextMoves.size() - 1))]);
+                        moves++;
+                    }
+                }
+                return moves; });
+
+    const Game initial = Game::fromYaml(rootNode, compatibility);
+    BatchPlayout vectorized(initial, args.games, 1, true);
+    measure(std::string("BatchPlayout ") + BatchPlayout::getKernelName(), [&vectorized]
+            { return vectorized.playToEnd(); });
+    BatchPlayout scalar(initial, args.games, 1, false);
+    measure("BatchPlayout scalar", [&scalar]
+            { return scalar.playToEnd(); });
+    return 0;
+}
@@ -0,0 +1,103 @@
+#include "yaml-cpp/yaml.h"
+
+#include "game.h"
+#include "playout.h"
+#include "random.h"
+
+#include <chrono>
+#include <iostream>
+
+namespace
+{
+    struct Args
+    {
+        std::string tilesYamlPath;
+        double seconds = 5.0;
+    };
+
+    Args parseArgs(int argc, char **argv)
+    {
+        if (argc < 2 || argc > 3)
+        {
+            std::cout << "Error: did not pass the expected number of args." << std::endl;
+            std::cout << "Usage: " << argv[0] << " path-to-tiles-yaml [seconds-per-engine]" << std::endl;
+            std::exit(1);
+        }
+        Args args;
+        args.tilesYamlPath = argv[1];
+        if (argc > 2)
+        {
+            args.seconds = std::stod(argv[2]);
+        }
+        return args;
+    }
+
+    struct Result
+    {
+        long long games = 0;
+        long long moves = 0;
+        long long finishedTasks = 0;
+        double seconds = 0;
+    };
+
+    // Only playing is timed: setUp prepares each game (reading the tileset, shuffling) before the clock starts.
+    template <class SetUp, class PlayGame>
+    Result measure(double seconds, SetUp setUp, PlayGame playGame)
+    {
+        using Clock = std::chrono::steady_clock;
+        Result result;
+        while (result.seconds < seconds)
+        {
+            auto game = setUp();
+            const auto start = Clock::now();
+            const auto [moves, finishedTasks] = playGame(game);
+            result.seconds += std::chrono::duration<double>(Clock::now() - start).count();
+            result.games++;
+            result.moves += moves;
+            result.finishedTasks += finishedTasks;
+        }
+        return result;
+    }
+
+    void report(const std::string &name, const Result &result)
+    {
+        std::cout << name << ": " << result.games / result.seconds << " games/s on one core, "
+                  << static_cast<double>(result.moves) / result.games << " moves/game, "
+                  << static_cast<double>(result.finishedTasks) / result.games << " finished tasks/game" << std::endl;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    Args args = parseArgs(argc, argv);
+    YAML::Node rootNode = YAML::LoadFile(args.tilesYamlPath);
+    setSeed(1);
+
+    const auto compatibility = Game::loadCompatibility(rootNode);
+    const Playout initial = Playout::fromGame(Game::fromYaml(rootNode, compatibility));
+    std::mt19937 rng(1);
+    report("Playout", measure(
+                          args.seconds, [&initial, &rng]
+                          {
+                              Playout playout = initial;
+                              playout.shuffleRemainingTiles(rng);
+                              return playout; },
+                          [&rng](Playout &playout)
+                          {
+                              const int finishedTasks = playout.playToEnd(rng);
+                              return std::make_pair(playout.getPlacedTilesCount(), finishedTasks); }));
+
+    report("Game::nextMoves", measure(
+                                  args.seconds, [&rootNode, &compatibility]
+                                  { return Game::fromYaml(rootNode, compatibility); },
+                                  [](Game &game)
+                                  {
+                                      int moves = 0;
+                                      for (std::vector<Move> nextMoves = game.nextMoves(); !nextMoves.empty(); nextMoves = game.nextMoves())
+                                      {
+                                          game.makeMove(nextMoves[getRandom(std::uniform_int_distribution<int>(0, nextMoves.size() - 1))]);
+                                          moves++;
+                                      }
+                                      return std::make_pair(moves, static_cast<int>(game.getFinishedTasks().size())); }));
+    return 0;
+}
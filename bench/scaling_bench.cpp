@@ -0,0 +1,89 @@
+#include "yaml-cpp/yaml.h"
+
+#include "game.h"
+#include "random.h"
+#include "tileset_generator.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+#include <unistd.h>
+
+namespace
+{
+    constexpr int CHECKPOINTS = 10;
+
+    struct Args
+    {
+        std::vector<int> tileCounts{1000, 10000, 100000};
+    };
+
+    Args parseArgs(int argc, char **argv)
+    {
+        Args args;
+        if (argc > 1)
+        {
+            args.tileCounts.clear();
+            for (int i = 1; i < argc; i++)
+            {
+                args.tileCounts.push_back(std::stoi(argv[i]));
+            }
+        }
+        return args;
+    }
+
+    double getResidentMegabytes()
+    {
+        std::ifstream statm("/proc/self/statm");
+        long totalPages = 0, residentPages = 0;
+        statm >> totalPages >> residentPages;
+        return static_cast<double>(residentPages) * sysconf(_SC_PAGESIZE) / (1024 * 1024);
+    }
+
+    void playGame(int tiles)
+    {
+        using Clock = std::chrono::steady_clock;
+        TilesetOptions options;
+        options.tiles = tiles;
+        Game game = Game::fromYaml(generateTileset(options));
+        std::cout << "== " << tiles << " tiles ==" << std::endl;
+        std::cout << std::setw(10) << "moves" << std::setw(14) << "us/move" << std::setw(14) << "moves/turn"
+                  << std::setw(12) << "frontier" << std::setw(10) << "groups" << std::setw(12) << "RSS MB" << std::endl;
+
+        const int checkpointEvery = std::max(1, game.getRemainingTilesCount() / CHECKPOINTS);
+        int moves = 0;
+        long long legalMoves = 0;
+        auto windowStart = Clock::now();
+        for (std::vector<Move> nextMoves = game.nextMoves(); !nextMoves.empty(); nextMoves = game.nextMoves())
+        {
+            legalMoves += nextMoves.size();
+            game.makeMove(nextMoves[getRandom(std::uniform_int_distribution<int>(0, nextMoves.size() - 1))]);
+            moves++;
+            if (moves % checkpointEvery == 0)
+            {
+                const double micros = std::chrono::duration<double, std::micro>(Clock::now() - windowStart).count();
+                std::cout << std::setw(10) << moves << std::setw(14) << std::fixed << std::setprecision(1) << micros / checkpointEvery
+                          << std::setw(14) << static_cast<double>(legalMoves) / checkpointEvery
+                          << std::setw(12) << game.getBoard().getFrontierSize() << std::setw(10) << game.getBoard().getFrontierGroups().size()
+                          << std::setw(12) << getResidentMegabytes() << std::endl;
+                legalMoves = 0;
+                windowStart = Clock::now();
+            }
+        }
+        std::cout << "Game over after " << moves << " moves, " << game.getFinishedTasks().size() << " tasks finished." << std::endl;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    Args args = parseArgs(argc, argv);
+    setSeed(1);
+    for (int tiles : args.tileCounts)
+    {
+        playGame(tiles);
+    }
+    return 0;
+}
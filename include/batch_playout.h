@@ -0,0 +1,59 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "game.h"
+#include "playout.h"
+
+// Random rollouts of many independent games in lockstep. Each game is a Playout, and the engine keeps a
+// struct-of-arrays copy of their frontiers: the signature of the i-th frontier cell of game k lives at
+// [i * stride + k], next to the same cell index of the other games. Edge compatibility of one frontier index
+// and rotation is then checked for all games at once, 8 games per instruction with AVX2 and 4 with SSE2. The
+// AVX2 kernel is built without -mavx2 and picked at runtime on CPUs which support it.
+// Task rules are checked per game, only for task tiles whose edges fit.
+class BatchPlayout
+{
+public:
+    // Starts `games` copies of the game, each with its remaining tiles shuffled differently.
+    BatchPlayout(const Game &game, int games, unsigned seed, bool vectorized = true);
+
+    static const char *getKernelName(); // the vector kernel chosen for this CPU, "scalar" if none
+
+    // Draws a tile in every game still running, returns false when all games are over.
+    bool drawNextTiles();
+    // Places the drawn tiles in uniformly random legal positions, like Playout::playRandomMove.
+    // Returns the number of placed tiles; a game without a legal move is over.
+    int playDrawnTiles();
+    int playRandomMoves() { return drawNextTiles() ? playDrawnTiles() : 0; }
+    // Plays all games to the end, returns the number of placed tiles.
+    long long playToEnd();
+
+    int getGamesCount() const { return m_games.size(); }
+    auto getGame(int game) const -> const Playout & { return m_games.at(game); }
+    bool isRunning(int game) const { return m_running.at(game); }
+    // Bit k % 64 of word k / 64 is set if the edges of the tile drawn in game k fit its frontier cell `index`
+    // in the rotation. Games without a drawn tile or with a smaller frontier never fit.
+    void getFittingGames(int index, int rotation, std::vector<std::uint64_t> &fitting) const;
+
+private:
+    std::vector<Playout> m_games;
+    std::vector<bool> m_running;
+    std::mt19937 m_rng;
+    bool m_vectorized;
+
+    int m_stride; // games rounded up to a whole number of vector lanes
+    int m_capacity = 0; // frontier cells per game which fit into m_signatures
+    std::vector<std::uint32_t> m_signatures;                             // [frontier index][game]
+    std::array<std::vector<std::uint32_t>, Tile::ROTATIONS> m_drawnEdges; // [rotation][game]
+    std::vector<std::int32_t> m_frontierSizes;                           // [game], 0 without a drawn tile
+
+    std::vector<std::vector<std::pair<int, int>>> m_scratchMoves; // (frontier index, rotation) per game
+    std::vector<std::uint64_t> m_scratchFitting;
+
+    void reserveFrontier(int cells);
+    void syncFrontierCell(int game, int index);
+    void syncAfterPlacing(int game, CellId placed, int coveredIndex);
+};
@@ -1,8 +1,14 @@
 #pragma once
 
+#include <array>
+#include <cstdint>
+#include <functional>
 #include <iosfwd>
+#include <map>
+#include <optional>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include "tile.h"
 
@@ -34,28 +40,79 @@ struct PlacedTile
     const Tile &tile;
     CellId id;
     int rotation = 0;
+
+    Terrain getEdgeTowards(int absoluteDirection) const;
 };
 
+// Terrains which the neighbors of an empty cell require on each of its sides, 3 bits per absolute direction.
+using ConstraintSignature = std::uint32_t;
+
 class Board
 {
 public:
+    static constexpr std::uint32_t FREE_SIDE = 7; // no neighbor on this side
+    static constexpr ConstraintSignature FREE_SIGNATURE = 0777777;
+    // Symmetry s mirrors the board first when s >= 6 (NW <-> SW, N <-> S, NE <-> SE), then rotates it clockwise
+    // around CellId{0, 0} by s % 6 steps of 60 degrees.
+    static constexpr int SYMMETRIES = 12;
+    // Ordered by signature, with the cells of each group sorted, so that the order does not depend on the history
+    // of the board.
+    using FrontierGroups = std::map<ConstraintSignature, std::vector<CellId>>;
+
     bool hasTileAt(CellId id) const;
     PlacedTile getTileAt(CellId id) const;
     void putAt(CellId id, const Tile &tile, int rotation);
     void removeAt(CellId id);
+    // Replaces the tile of each placed tile by rebind(tile), e.g. by the same tile in the storage of a copied game.
+    // The tiles must have the same edges and tasks.
+    void rebindTiles(const std::function<const Tile &(const Tile &)> &rebind);
     auto getNeighbors(CellId id) const -> std::vector<PlacedTile>;
     auto getNeighbor(CellId id, int absoluteDirection) const -> std::optional<PlacedTile>;
     auto getEmptyNeighbors(CellId id) const -> std::vector<CellId>;
     bool isEmpty() const { return m_tiles.empty(); }
     auto getPlacesForNextTile() const -> std::vector<CellId>;
+    // Empty cells adjacent to the board, grouped by the constraints of their neighbors.
+    auto getFrontierGroups() const -> const FrontierGroups & { return m_frontierGroups; }
+    auto getFrontierSize() const -> std::size_t { return m_frontier.size(); }
+    auto getSignature(CellId id) const -> ConstraintSignature; // FREE_SIGNATURE for cells outside of the frontier
     auto getTiles() const -> std::unordered_map<CellId, PlacedTile> { return m_tiles; }
 
     static auto getPotentialNeighbors(CellId id) -> std::array<CellId, Tile::ROTATIONS>;
     static bool areNeighbors(CellId lhs, CellId rhs);
 
+    // Axial (q, r) coordinates of a cell, in which neighbor deltas do not depend on the column parity.
+    static auto toAxial(CellId id) -> std::pair<int, int>;
+    static CellId fromAxial(int q, int r);
+
     // Finds (rotation1, rotation2) of adjacent tiles, aka which rotation/edge of each tile is adjacent to the other one.
     static auto getEdge(CellId adjacent1, CellId adjacent2) -> std::pair<int, int>;
 
+    static CellId transformCell(CellId id, int symmetry);
+    static int transformDirection(int absoluteDirection, int symmetry);
+    // Terrains of the transformed tile in each absolute direction. A mirrored tile is not a rotation of the
+    // original one in general, so placements are compared by these edges instead of (tile, rotation).
+    static auto transformEdges(const PlacedTile &placed, int symmetry) -> std::array<Terrain, Tile::ROTATIONS>;
+    // Zobrist-like hash of the board transformed by the symmetry, over the cells, edges and tasks of its tiles,
+    // kept up to date by putAt and removeAt.
+    auto getSymmetryHash(int symmetry) const -> std::uint64_t { return m_symmetryHashes.at(symmetry); }
+    // The same for all rotated copies of a board, for caches shared across equivalent positions. Mirrored copies
+    // get other hashes: a mirrored tile is a different tile, which the bag need not contain, so they do not play
+    // the same.
+    auto getCanonicalHash() const -> std::uint64_t;
+    int getCanonicalSymmetry() const; // the rotation, 0..5, whose hash is the canonical one
+    // The smallest hash of the mirrored symmetries, equal to getCanonicalHash() of the mirrored board. Callers
+    // which do treat mirrored boards as equivalent can fold both.
+    auto getMirroredCanonicalHash() const -> std::uint64_t;
+
+    static auto getSide(ConstraintSignature signature, int absoluteDirection) -> std::optional<Terrain>;
+    static auto withSide(ConstraintSignature signature, int absoluteDirection, std::uint32_t side) -> ConstraintSignature;
+
 private:
     std::unordered_map<CellId, PlacedTile> m_tiles;
+    std::unordered_map<CellId, ConstraintSignature> m_frontier;
+    FrontierGroups m_frontierGroups;
+    std::array<std::uint64_t, SYMMETRIES> m_symmetryHashes{};
+
+    void setSignature(CellId id, ConstraintSignature signature);
+    void toggleSymmetryHashes(const PlacedTile &placed);
 };
\ No newline at end of file
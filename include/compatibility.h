@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "tile.h"
+
+// For every absolute direction and every terrain of the neighbor edge in that direction, a bitset of the
+// (tile, rotation) pairs of a tileset which fit there. Tile i rotated by r is bit 8 * i + r, so all rotations
+// of one tile live in one byte. Tiles are identified by Tile::getCatalogIndex().
+class CompatibilityMatrix
+{
+public:
+    static constexpr int TERRAINS = 6;
+
+    static auto build(const std::vector<Tile> &catalog) -> std::shared_ptr<const CompatibilityMatrix>;
+    // Maps the matrix cached next to the yaml file, or builds it and tries to store it there.
+    static auto loadOrBuild(const std::vector<Tile> &catalog, const std::string &tilesYamlPath) -> std::shared_ptr<const CompatibilityMatrix>;
+    static std::uint64_t hashTileset(const std::vector<Tile> &catalog);
+    static std::string getCachePath(const std::string &tilesYamlPath, std::uint64_t tilesetHash);
+
+    CompatibilityMatrix(const CompatibilityMatrix &) = delete;
+    CompatibilityMatrix &operator=(const CompatibilityMatrix &) = delete;
+    ~CompatibilityMatrix();
+
+    int getTilesCount() const { return m_tilesCount; }
+    int getWordsCount() const { return m_wordsCount; }
+    std::uint64_t getTilesetHash() const { return m_tilesetHash; }
+    bool isMapped() const { return m_mapping != nullptr; }
+
+    auto getBitset(int absoluteDirection, Terrain neighborEdge) const -> const std::uint64_t *;
+    // Bits 0..5: rotations in which the tile fits next to neighborEdge lying in absoluteDirection.
+    std::uint8_t getRotations(int catalogIndex, int absoluteDirection, Terrain neighborEdge) const;
+
+private:
+    CompatibilityMatrix() = default;
+
+    int m_tilesCount = 0;
+    int m_wordsCount = 0;
+    std::uint64_t m_tilesetHash = 0;
+    const std::uint64_t *m_bits = nullptr; // points into m_owned or m_mapping
+    std::vector<std::uint64_t> m_owned;
+    void *m_mapping = nullptr;
+    std::size_t m_mappingSize = 0;
+
+    static auto map(const std::string &path, std::uint64_t tilesetHash, int tilesCount) -> std::shared_ptr<const CompatibilityMatrix>;
+    void save(const std::string &path) const;
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Messages between the self-play farm coordinator and its workers. Both ends run on the same machine, so
+// integers are sent in the host byte order. Each message is a FrameHeader followed by `size` bytes of payload.
+enum class FarmMessageType : std::uint32_t
+{
+    Hello = 1,  // worker -> coordinator, payload: u32 worker slot
+    Job,        // coordinator -> worker, payload: FarmJob
+    GameRecord, // worker -> coordinator, payload: ReplayRecord
+    JobDone,    // worker -> coordinator, no payload; the worker waits for the next job
+    Stop,       // coordinator -> worker, no payload
+};
+
+struct FarmMessage
+{
+    FarmMessageType type;
+    std::vector<char> payload;
+};
+
+// Games with the seeds firstSeed, firstSeed + 1, ..., firstSeed + games - 1.
+struct FarmJob
+{
+    std::uint32_t firstSeed = 0;
+    std::uint32_t games = 0;
+};
+
+struct ReplayMove
+{
+    std::int16_t x = 0;
+    std::int16_t y = 0;
+    std::uint8_t rotation = 0;
+    std::uint8_t taskSize = 0; // 0 for lands
+};
+
+// A game is determined by its seed and the moves played, see playRecordedGame.
+struct ReplayRecord
+{
+    std::uint32_t seed = 0;
+    std::int32_t finishedTasks = 0;
+    std::vector<ReplayMove> moves;
+};
+
+constexpr std::uint32_t MAX_FARM_PAYLOAD_SIZE = 16 * 1024 * 1024;
+
+// Both throw std::runtime_error on I/O errors. readMessage returns false on the end of the stream before a
+// message, and throws if the stream ends inside one.
+void writeMessage(int fd, FarmMessageType type, const std::vector<char> &payload = {});
+bool readMessage(int fd, FarmMessage &message);
+
+auto encodeJob(const FarmJob &job) -> std::vector<char>;
+auto decodeJob(const std::vector<char> &payload) -> FarmJob;
+auto encodeReplay(const ReplayRecord &record) -> std::vector<char>;
+auto decodeReplay(const std::vector<char> &payload) -> ReplayRecord;
@@ -1,15 +1,22 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
 #include <istream>
+#include <memory>
 #include <optional>
+#include <string>
 #include <vector>
 #include <unordered_map>
 
 #include "yaml-cpp/yaml.h"
 
 #include "board.h"
+#include "compatibility.h"
 #include "move.h"
 #include "tile.h"
+#include "tile_catalog.h"
 
 struct Task
 {
@@ -18,22 +25,137 @@ struct Task
     Terrain terrain;
 };
 
+struct TileOutcome
+{
+    int type; // index in Game::getCatalog()
+    double probability;
+};
+
+// One result of the chance event before a move: the next tile and, for a task tile, its task size.
+struct ChanceOutcome
+{
+    int type; // index in Game::getCatalog()
+    std::optional<int> taskSize;
+    double probability;
+};
+
+class Game;
+
+// Legal moves of the tile drawn in a game, generated one at a time in the order of Game::nextMoves(), so that
+// a caller which stops early skips the rest of the work. Edge fit is computed once per frontier group, tasks
+// are checked only for the moves actually reached. Moves come by group in the order of Board::FrontierGroups,
+// then by position and rotation, so equal boards give the same order however they were built, but positions
+// are not sorted across groups. Iterators become invalid when the board changes.
+class MoveGenerator
+{
+public:
+    class Iterator
+    {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = Move;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Move *;
+        using reference = const Move &;
+
+        reference operator*() const { return m_move; }
+        pointer operator->() const { return &m_move; }
+        Iterator &operator++();
+        bool operator==(const Iterator &other) const { return m_done && other.m_done; } // only the end is comparable
+        bool operator!=(const Iterator &other) const { return !(*this == other); }
+
+    private:
+        friend class MoveGenerator;
+        using GroupIterator = Board::FrontierGroups::const_iterator;
+
+        const Game *m_game = nullptr;
+        GroupIterator m_group;
+        const std::vector<CellId> *m_cells = nullptr;
+        int m_cellIndex = 0;
+        int m_rotation = 0;
+        std::uint8_t m_rotations = 0; // fitting rotations of the current group
+        Move m_move{};
+        bool m_done = true;
+
+        void enterGroup(ConstraintSignature signature, const std::vector<CellId> &cells);
+        void advance();
+    };
+
+    Iterator begin() const;
+    Iterator end() const { return Iterator(); }
+
+private:
+    friend class Game;
+    explicit MoveGenerator(const Game &game) : m_game(&game) {}
+    const Game *m_game;
+};
+
 class Game
 {
 public:
     static constexpr int MAX_CONCURRENT_TASKS = 3;
     static constexpr int UNUSED_LANDS = 3;
     static Game fromYaml(const YAML::Node &rootNode, bool shuffle = true);
+    // Like fromYaml, but also caches the compatibility matrix of the tileset next to the yaml file.
+    static Game fromYamlFile(const std::string &tilesYamlPath, bool shuffle = true);
+    // The compatibility matrix of the tileset, to be shared by its games through the fromYaml overload below
+    // instead of being built for each game. With a path, the matrix is mapped from the cache next to the file.
+    // Does not use the random engine.
+    static auto loadCompatibility(const YAML::Node &rootNode, const std::string &tilesYamlPath = {}) -> std::shared_ptr<const CompatibilityMatrix>;
+    // Uses the matrix from loadCompatibility, or builds one if it is nullptr. Throws if the matrix was built for
+    // another tileset.
+    static Game fromYaml(const YAML::Node &rootNode, std::shared_ptr<const CompatibilityMatrix> compatibility, bool shuffle = true);
+
+    // A copy places its board and drawn tiles in its own tile storage, so it outlives the original. Tiles which
+    // the caller placed from elsewhere are still shared and must outlive both games.
+    Game() = default;
+    Game(const Game &other);
+    Game(Game &&other) = default; // moving the vectors keeps the tiles where they are
+    Game &operator=(const Game &other);
+    Game &operator=(Game &&other) = default;
+    ~Game() = default;
 
     bool canPlaceTileAt(const Tile &tile, CellId position, int rotation, std::optional<int> taskSize = std::nullopt);
     void placeTileAt(const Tile &tile, CellId position, int rotation, std::optional<int> taskSize = std::nullopt);
     void makeMove(const Move& move);
+    // Bits 0..5: rotations in which the edges of the tile fit its neighbors at the position, ignoring tasks.
+    std::uint8_t getFittingRotations(const Tile &tile, CellId position) const;
+    std::uint8_t getFittingRotations(const Tile &tile, ConstraintSignature signature) const;
 
     auto getLands() const -> const std::vector<Tile> & { return m_lands; }
     auto getTasks() const -> const std::vector<Tile> & { return m_tasks; }
+    auto getCatalog() const -> const TileCatalog & { return m_catalog; }
+    auto getCompatibility() const -> const CompatibilityMatrix * { return m_compatibility.get(); }
+    auto getBoard() const -> const Board & { return m_board; }
+    auto getCurrentTasks() const -> const std::vector<Task> & { return m_currentTasks; }
+    auto getFinishedTasks() const -> const std::vector<Task> & { return m_finishedTasks; }
+    int getRemainingTilesCount() const;
+    int getRemainingCount(int type) const { return m_remainingCounts.at(type); } // copies of the type not yet taken
+    // Distinct tiles which takeNextTileToPlay() can return, assuming that the order of the remaining tiles is unknown.
+    // Empty when the game is over.
+    std::vector<TileOutcome> getNextTileOutcomes() const;
+    // Like getNextTileOutcomes, with task tiles split further by the free sizes of their tasks. Throws when a task
+    // tile may come next, but no sizes of its task are left, i.e. when nextMoves() would throw, and while a drawn
+    // tile waits to be placed, like drawNextTile(outcome).
+    std::vector<ChanceOutcome> getChanceOutcomes() const;
+    int getNextLandIndex() const { return m_nextLandIndex; }
+    int getNextTaskIndex() const { return m_nextTaskIndex; }
+    auto getFreeTaskSizes() const -> const std::unordered_multimap<Terrain, int> & { return m_freeTaskSizes; }
+    // Low-level drawing which bypasses the drawn tile below, for engines which keep their own turn state.
     auto takeNextTileToPlay() -> std::optional<Tile *>; // non-owning, the tile will live as long as the game
     int fetchTaskSize(Terrain task);
-    std::vector<Move> nextMoves(); // takes next tile, so do not call twice
+
+    // Takes the next tile and its task size, unless a drawn tile is still waiting to be placed.
+    // Returns false when there are no tiles left.
+    bool drawNextTile();
+    // Takes the tile and the task size of the outcome, one of getChanceOutcomes(), instead of random ones.
+    void drawNextTile(const ChanceOutcome &outcome);
+    auto getDrawnTile() const -> Tile *; // non-owning like Move::tile, nullptr when no tile waits to be placed
+    auto getDrawnTaskSize() const -> std::optional<int> { return m_drawnTaskSize; }
+    auto generateMoves() const -> MoveGenerator { return MoveGenerator(*this); } // moves of the drawn tile
+    // All moves of the drawn tile, drawing it first if needed. Calling it again before a move returns the same moves.
+    std::vector<Move> nextMoves();
+    std::vector<Move> nextMoves(const ChanceOutcome &outcome); // drawNextTile(outcome), then all its moves
 
 private:
     std::vector<Tile> m_lands; // TODO: there are so many references to these tiles. Make m_lands const.
@@ -44,9 +166,25 @@ private:
     std::vector<Task> m_finishedTasks;
     std::unordered_multimap<Terrain, int> m_freeTaskSizes;
     Board m_board;
+    TileCatalog m_catalog;
+    std::vector<int> m_remainingCounts; // per type of m_catalog
+    std::shared_ptr<const CompatibilityMatrix> m_compatibility;
+    // The drawn tile as an index into m_tasks or m_lands, so that a copy of the game refers to its own tile.
+    bool m_drawnIsTask = false;
+    int m_drawnIndex = -1; // -1 when no tile is drawn
+    std::optional<int> m_drawnTaskSize;
+    // Keep the copy constructor in sync when adding members.
+
+    friend class MoveGenerator;
 
+    void parseYaml(const YAML::Node &rootNode, bool shuffle);
     void parseYamlTasks(const YAML::Node &rootNode);
     void parseYamlTiles(const YAML::Node &rootNode, bool shuffle);
 
+    bool drawsTaskNext() const;
+    void setDrawnTile(const Tile *tile, std::optional<int> taskSize); // tile is the last one taken
+    auto takeTileToPlay(int type) -> Tile *;
+    void takeTaskSize(Terrain task, int taskSize);
     void updateFinishedOrImpossibleTasks(CellId placedTileId);
+    bool keepsTasksPossible(const Tile &tile, CellId position, int rotation, int taskSize) const;
 };
\ No newline at end of file
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "game.h"
+#include "move.h"
+
+// A book move, stored in the canonical orientation of its position (see Board::getCanonicalSymmetry), so that
+// one entry serves all rotated copies of the position.
+struct BookEntry
+{
+    std::uint64_t key;   // OpeningBook::getPositionKey
+    std::int16_t x;      // canonical cell of the move
+    std::int16_t y;
+    std::uint32_t edges; // canonical terrains of the placed tile in each absolute direction, 3 bits each
+    std::uint32_t visits; // rollouts which evaluated the move
+    float meanScore;      // mean finished tasks at the end of those rollouts
+};
+static_assert(sizeof(BookEntry) == 24, "BookEntry is stored as is");
+
+// Best moves for early positions, stored as a file of entries sorted by key and mapped read-only, so that a
+// lookup is a binary search in memory shared by all processes using the book.
+class OpeningBook
+{
+public:
+    static constexpr int DEFAULT_DEPTH = Game::MAX_CONCURRENT_TASKS; // the first task tiles
+
+    // Key of the position with its drawn tile, the same for all rotated copies. Covers the board, the drawn
+    // tile and its task size, and the open tasks, but not the tiles left in the bag. Requires a drawn tile.
+    static std::uint64_t getPositionKey(const Game &game);
+    static BookEntry makeEntry(const Game &game, const Move &move, std::uint32_t visits, float meanScore);
+    // The legal move of the drawn tile which the entry describes, nullopt if there is none (a key collision).
+    static std::optional<Move> findMove(const Game &game, const BookEntry &entry);
+
+    // Sorts the entries by key and writes them; of entries with the same key, the one with most visits is kept.
+    static void save(const std::string &path, std::vector<BookEntry> entries);
+    // Throws std::runtime_error if the file is not a book.
+    static auto map(const std::string &path) -> std::shared_ptr<const OpeningBook>;
+
+    OpeningBook(const OpeningBook &) = delete;
+    OpeningBook &operator=(const OpeningBook &) = delete;
+    ~OpeningBook();
+
+    auto find(std::uint64_t key) const -> const BookEntry *; // nullptr if the position is not in the book
+    std::optional<Move> lookup(const Game &game) const;      // the book move for the drawn tile of the game
+    auto getEntriesCount() const -> std::size_t { return m_entriesCount; }
+
+private:
+    OpeningBook() = default;
+
+    void *m_mapping = nullptr;
+    std::size_t m_mappingSize = 0;
+    const BookEntry *m_entries = nullptr;
+    std::size_t m_entriesCount = 0;
+};
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <random>
+#include <vector>
+
+#include "board.h"
+#include "game.h"
+#include "tile.h"
+
+// Compact copy of a Game for Monte Carlo rollouts. The board is a small open-addressing table of packed
+// cells, tiles are packed into 18 bits of edges, and task regions are extended incrementally when tiles
+// are placed instead of being searched again after every move. Rules are the same as in Game.
+// Coordinates must stay within the int16 range.
+class Playout
+{
+public:
+    // Copies the game, including its drawn tile if one waits to be placed. Tiles taken by takeNextTileToPlay()
+    // directly are not known to the game, so they must be placed before copying.
+    static Playout fromGame(const Game &game);
+
+    void shuffleRemainingTiles(std::mt19937 &rng);
+    // Takes the next tile like Game::takeNextTileToPlay, a task tile also takes a random task size unless one is given.
+    // Returns false when there are no more tiles to play.
+    bool drawNextTile(std::mt19937 &rng, std::optional<int> taskSize = std::nullopt);
+    bool isLegal(CellId position, int rotation) const; // for the drawn tile
+    void place(CellId position, int rotation);         // places the drawn tile
+    // Places the drawn tile in a uniformly random legal position and rotation. Returns false if there is none.
+    bool playRandomMove(std::mt19937 &rng);
+    // Plays random moves until the game is over, returns the number of finished tasks.
+    int playToEnd(std::mt19937 &rng);
+
+    int getFinishedTasksCount() const { return m_finishedTasksCount; }
+    int getCurrentTasksCount() const { return m_tasks.size(); }
+    int getPlacedTilesCount() const { return m_placedTilesCount; }
+    int getFrontierSize() const { return m_frontier.size(); }
+    int countLegalMoves() const;
+
+    // Access by the index of a cell in the frontier, for engines which keep their own copy of it. Placing a tile
+    // moves the last frontier cell into the place of the covered one and adds or changes only its neighbors.
+    bool hasDrawnTile() const { return m_drawn.has_value(); }
+    bool isDrawnTileTask() const { return m_drawn && m_drawn->task >= 0; }
+    // Absolute edges of the drawn tile placed with the rotation, packed like a ConstraintSignature.
+    std::uint32_t getDrawnEdges(int rotation) const { return rotate(m_drawn->edges, rotation); }
+    CellId getFrontierCell(int index) const { return fromKey(m_frontier.at(index)); }
+    ConstraintSignature getFrontierSignature(int index) const { return find(m_frontier.at(index))->edges; }
+    int getFrontierIndex(CellId cell) const; // -1 when the cell is not in the frontier
+    bool isLegalAtFrontier(int index, int rotation) const;
+    void placeAtFrontier(int index, int rotation);
+
+private:
+    using PackedEdges = std::uint32_t; // 3 bits per direction, the same layout as ConstraintSignature
+
+    struct PackedTile
+    {
+        PackedEdges edges;
+        int task; // terrain of the task, or -1 for lands
+    };
+
+    struct Slot
+    {
+        std::uint32_t key;
+        PackedEdges edges;  // absolute edges of a placed tile, or the signature of a frontier cell
+        int frontierIndex; // OCCUPIED for placed tiles
+    };
+
+    struct PlayoutTask
+    {
+        int size;
+        int terrain;
+        std::vector<std::uint32_t> region;  // cells of the connected terrain, like in Game's search
+        std::vector<std::uint32_t> pending; // empty cells which region edges of the terrain lead to
+    };
+
+    enum class TaskStatus
+    {
+        Open,
+        Finished,
+        Failed,
+    };
+
+    static constexpr int OCCUPIED = -1;
+    static constexpr std::uint32_t EMPTY_KEY = 0xffffffff;
+    static constexpr int MAX_REJECTION_ATTEMPTS = 64;
+
+    std::vector<PackedTile> m_lands;
+    int m_nextLand = 0;
+    std::vector<PackedTile> m_taskTiles;
+    int m_nextTaskTile = 0;
+    std::array<std::vector<int>, CompatibilityMatrix::TERRAINS> m_freeTaskSizes;
+
+    std::vector<Slot> m_slots;
+    int m_usedSlots = 0;
+    int m_shift = 32;
+    std::vector<std::uint32_t> m_frontier;
+    int m_placedTilesCount = 0;
+
+    std::vector<PlayoutTask> m_tasks;
+    int m_finishedTasksCount = 0;
+
+    std::optional<PackedTile> m_drawn;
+    int m_drawnTaskSize = 0;
+
+    mutable PlayoutTask m_scratchTask;
+    mutable std::vector<std::pair<std::uint32_t, int>> m_scratchMoves;
+
+    static std::uint32_t toKey(CellId id);
+    static CellId fromKey(std::uint32_t key);
+    static std::uint32_t getNeighborKey(std::uint32_t key, int direction);
+    static PackedEdges pack(const Tile &tile);
+    static PackedEdges rotate(PackedEdges edges, int rotation);
+    static bool fits(PackedEdges absoluteEdges, ConstraintSignature signature);
+
+    auto find(std::uint32_t key) const -> const Slot *;
+    auto find(std::uint32_t key) -> Slot *;
+    auto insert(std::uint32_t key) -> Slot &;
+    void reserveSlots(int slots);
+    void removeFromFrontier(Slot &slot);
+    auto getEdges(std::uint32_t key, std::uint32_t extraKey, PackedEdges extraEdges) const -> std::optional<PackedEdges>;
+
+    bool isLegalAt(std::uint32_t key, ConstraintSignature signature, int rotation) const;
+    bool keepsTasksPossible(std::uint32_t key, PackedEdges absoluteEdges) const;
+    void placeAt(std::uint32_t key, int rotation);
+    int fetchTaskSize(int terrain, std::mt19937 &rng, std::optional<int> taskSize);
+
+    void expandTask(PlayoutTask &task, std::uint32_t from, std::uint32_t extraKey, PackedEdges extraEdges) const;
+    void advanceTask(PlayoutTask &task, std::uint32_t placedKey, PackedEdges placedEdges) const;
+    static TaskStatus getStatus(const PlayoutTask &task);
+};
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <optional>
+#include <vector>
+
+#include "game.h"
+#include "move.h"
+#include "opening_book.h"
+
+struct SearchOptions
+{
+    int rolloutsPerMove = 32;
+    unsigned seed = 1;
+};
+
+struct MoveStatistics
+{
+    Move move;
+    int visits;
+    double meanScore; // finished tasks at the end of the rollouts
+};
+
+// Flat Monte Carlo search: every legal move of the drawn tile is followed by random Playout rollouts, with the
+// unknown order of the remaining tiles shuffled for each rollout. Returns all legal moves, best first.
+std::vector<MoveStatistics> searchMoves(const Game &game, const SearchOptions &options);
+
+// The book move when the position is in the book, otherwise the best move of searchMoves; nullopt if there are
+// no legal moves. The book may be null.
+std::optional<Move> chooseMove(const Game &game, const OpeningBook *book, const SearchOptions &options, bool *fromBook = nullptr);
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+#include "yaml-cpp/yaml.h"
+
+#include "farm_protocol.h"
+#include "game.h"
+#include "move.h"
+#include "opening_book.h"
+#include "training_data.h"
+
+// Fills planes and taskState of a sample describing the game state after the (not yet played) move.
+void extractMoveFeatures(const Game &game, const Move &move, TrainingSample &sample);
+
+struct SelfPlayOptions
+{
+    int maxCandidatesPerTurn = 0; // 0 exports every legal move, otherwise a random subset which includes the played one
+    // Moves are uniformly random by default. With a book, its moves are played while the game is in the book; with
+    // rollouts, every move comes from chooseMove, which searches the positions out of the book.
+    const OpeningBook *book = nullptr;
+    int rolloutsPerMove = 0;
+};
+
+// Plays the game to the end with the moves of the options, exporting the candidate moves of every turn.
+// Returns the number of finished tasks, which is also the outcome stored in the samples.
+int playSelfPlayGame(Game &game, std::uint32_t gameId, TrainingDataWriter &writer, const SelfPlayOptions &options = {});
+
+// Plays a new game of the tileset with uniformly random moves. The game depends only on the seed, which also
+// reseeds the process-wide random engine; moves are chosen with a separate engine, so that they can be replayed.
+// The compatibility matrix comes from Game::loadCompatibility, or is built for the game if it is nullptr.
+ReplayRecord playRecordedGame(const YAML::Node &rootNode, std::uint32_t seed,
+                              std::shared_ptr<const CompatibilityMatrix> compatibility = nullptr);
+// Plays the moves of the record on a new game of the tileset, returns the number of finished tasks.
+// Throws if a move is not legal, e.g. when the record comes from another tileset.
+int replayGame(const YAML::Node &rootNode, const ReplayRecord &record, std::shared_ptr<const CompatibilityMatrix> compatibility = nullptr);
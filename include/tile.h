@@ -39,9 +39,12 @@ public:
     bool isLand() const { return !m_task.has_value(); }
     bool isTask() const { return m_task.has_value(); }
     Terrain getTask() const { return *m_task; }
-    Terrain setTask(Terrain task) { m_task = task; }
+    void setTask(Terrain task) { m_task = task; }
+    int getCatalogIndex() const { return m_catalogIndex; } // -1 for tiles not read from a tileset
+    void setCatalogIndex(int index) { m_catalogIndex = index; }
 
 private:
     std::array<Terrain, ROTATIONS> m_edges;
     std::optional<Terrain> m_task;
+    int m_catalogIndex = -1;
 };
\ No newline at end of file
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "tile.h"
+
+// Distinct tiles of a tileset, each with the number of its copies. Tiles are identical when their edges and
+// tasks are equal; rotations of a tile are different types, because the yaml order of edges matters for moves.
+class TileCatalog
+{
+public:
+    // Adds a copy of the tile and returns the index of its type.
+    int intern(const Tile &tile);
+
+    int getTypesCount() const { return m_types.size(); }
+    auto getType(int type) const -> const Tile & { return m_types.at(type); } // getCatalogIndex() of a type is its index
+    int getCount(int type) const { return m_counts.at(type); }
+    int getTilesCount() const { return m_tilesCount; }
+    auto getTypes() const -> const std::vector<Tile> & { return m_types; } // in the order of first appearance
+    auto getCounts() const -> const std::vector<int> & { return m_counts; }
+
+private:
+    std::vector<Tile> m_types;
+    std::vector<int> m_counts;
+    std::unordered_map<std::uint32_t, int> m_typeByKey;
+    int m_tilesCount = 0;
+
+    static std::uint32_t getKey(const Tile &tile);
+};
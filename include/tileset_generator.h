@@ -0,0 +1,18 @@
+#pragma once
+
+#include <array>
+
+#include "yaml-cpp/yaml.h"
+
+struct TilesetOptions
+{
+    int tiles = 1000;
+    double taskTileShare = 0.1;                        // fraction of the tiles which are task tiles
+    std::array<double, 4> terrainWeights{1, 1, 1, 1}; // Grass, Plains, Forest, Town for edges not taken by Rail/River
+    double railDensity = 0.15;                         // probability that a tile has a rail
+    double riverDensity = 0.15;                        // probability that a tile has a river
+    unsigned seed = 1;
+};
+
+// Generates random tiles in the format of resources/tiles/tiles.yaml, with one `tasks:` entry per task tile.
+YAML::Node generateTileset(const TilesetOptions &options);
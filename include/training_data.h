@@ -0,0 +1,98 @@
+#pragma once
+
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "game.h"
+#include "tile.h"
+
+// Feature planes are sampled on a square window of axial coordinates centered at the candidate cell.
+// Channels 0..5 hold (terrain + 1) of the edge pointing to each absolute direction, 0 for an empty cell.
+// Channel 6 holds (task terrain + 1) for task tiles.
+constexpr int FEATURE_WINDOW_RADIUS = 2;
+constexpr int FEATURE_WINDOW_SIDE = 2 * FEATURE_WINDOW_RADIUS + 1;
+constexpr int FEATURE_CHANNELS = Tile::ROTATIONS + 1;
+constexpr int FEATURE_PLANES_SIZE = FEATURE_CHANNELS * FEATURE_WINDOW_SIDE * FEATURE_WINDOW_SIDE;
+
+// Per open task: terrain + 1, required size, axial dq, axial dr (relative to the candidate cell).
+// Then: task terrain + 1 of the candidate tile, its task size, tiles left to play, tasks finished so far.
+// Values outside of the int16 range, e.g. tiles left in generated tilesets of 100k tiles, saturate.
+constexpr int TASK_STATE_FIELDS = 4;
+constexpr int TASK_STATE_SIZE = Game::MAX_CONCURRENT_TASKS * TASK_STATE_FIELDS + 4;
+
+struct TrainingSample
+{
+    std::uint32_t gameId = 0;
+    std::uint16_t turn = 0;
+    std::uint8_t chosen = 0; // 1 if this candidate move was played in the game
+    std::int16_t outcome = 0; // tasks finished at the end of the game
+    std::array<std::uint8_t, FEATURE_PLANES_SIZE> planes{};
+    std::array<std::int16_t, TASK_STATE_SIZE> taskState{};
+};
+
+// Writes samples to a chunked, columnar file. Full chunks are compressed and written by background threads,
+// so append() only blocks if the threads fall behind by more than a few chunks.
+class TrainingDataWriter
+{
+public:
+    static constexpr std::size_t DEFAULT_SAMPLES_PER_CHUNK = 4096;
+
+    explicit TrainingDataWriter(const std::string &path, std::size_t samplesPerChunk = DEFAULT_SAMPLES_PER_CHUNK, int threads = 1);
+    TrainingDataWriter(const TrainingDataWriter &) = delete;
+    TrainingDataWriter &operator=(const TrainingDataWriter &) = delete;
+    ~TrainingDataWriter();
+
+    void append(const TrainingSample &sample);
+    void close(); // flushes the last chunk and joins the threads; rethrows errors from the background threads
+
+private:
+    struct PendingChunk
+    {
+        std::uint64_t sequence;
+        std::vector<TrainingSample> samples;
+    };
+
+    std::ofstream m_out;
+    std::size_t m_samplesPerChunk;
+    std::vector<TrainingSample> m_current;
+    std::uint64_t m_nextSequence = 0;
+    bool m_closed = false;
+
+    std::mutex m_mutex;
+    std::condition_variable m_queueChanged;
+    std::deque<PendingChunk> m_queue;
+    std::map<std::uint64_t, std::vector<char>> m_compressed; // finished out of order, waiting for their turn
+    std::uint64_t m_nextSequenceToWrite = 0;
+    bool m_stopping = false;
+    std::exception_ptr m_error;
+    std::vector<std::thread> m_threads;
+
+    void enqueueCurrentChunk();
+    void compressLoop();
+    void rethrowBackgroundError();
+};
+
+// Iterates samples of a file written by TrainingDataWriter, keeping only one chunk in memory.
+class TrainingDataReader
+{
+public:
+    explicit TrainingDataReader(const std::string &path);
+
+    bool next(TrainingSample &sample); // returns false after the last sample
+
+private:
+    std::ifstream m_in;
+    std::vector<TrainingSample> m_chunk;
+    std::size_t m_nextInChunk = 0;
+
+    bool readChunk();
+};
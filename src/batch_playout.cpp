@@ -0,0 +1,303 @@
+#include "batch_playout.h"
+
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace
+{
+    constexpr int MAX_LANES = 8;
+    constexpr int MIN_FRONTIER_CAPACITY = 64;
+    constexpr std::uint32_t SIDE_LOW_BITS = 0x9249; // bit 0 of each of the six 3-bit sides
+
+    // A side of the edges fits the side of a signature if the side is free (7), the terrains are equal, or both
+    // are lands (bit 2 clear), see areTerrainsCompatible. Every test ends up in bit 0 of the side.
+    std::uint32_t getMisfitSides(std::uint32_t edges, std::uint32_t signature)
+    {
+        const std::uint32_t diff = edges ^ signature;
+        const std::uint32_t notEqual = diff | diff >> 1 | diff >> 2;
+        const std::uint32_t notLands = (edges | signature) >> 2;
+        const std::uint32_t free = signature & signature >> 1 & signature >> 2;
+        return notEqual & notLands & ~free & SIDE_LOW_BITS;
+    }
+
+    void fitScalar(const std::uint32_t *edges, const std::uint32_t *signatures, const std::int32_t *frontierSizes,
+                   int index, int games, std::uint64_t *fitting)
+    {
+        for (int k = 0; k < games; k++)
+        {
+            if (index < frontierSizes[k] && getMisfitSides(edges[k], signatures[k]) == 0)
+            {
+                fitting[k / 64] |= std::uint64_t{1} << (k % 64);
+            }
+        }
+    }
+
+    using FitKernel = void (*)(const std::uint32_t *, const std::uint32_t *, const std::int32_t *, int, int, std::uint64_t *);
+
+#if defined(__x86_64__) || defined(__i386__)
+    // Compiled for AVX2 regardless of the build flags and only called when the CPU supports it, see getKernel.
+    __attribute__((target("avx2"))) void fitAvx2(const std::uint32_t *edges, const std::uint32_t *signatures,
+                                                 const std::int32_t *frontierSizes, int index, int games,
+                                                 std::uint64_t *fitting)
+    {
+        const __m256i lowBits = _mm256_set1_epi32(SIDE_LOW_BITS);
+        const __m256i indices = _mm256_set1_epi32(index);
+        for (int k = 0; k < games; k += 8)
+        {
+            const __m256i e = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(edges + k));
+            const __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(signatures + k));
+            const __m256i sizes = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(frontierSizes + k));
+            const __m256i diff = _mm256_xor_si256(e, s);
+            const __m256i notEqual = _mm256_or_si256(diff, _mm256_or_si256(_mm256_srli_epi32(diff, 1), _mm256_srli_epi32(diff, 2)));
+            const __m256i notLands = _mm256_srli_epi32(_mm256_or_si256(e, s), 2);
+            const __m256i free = _mm256_and_si256(s, _mm256_and_si256(_mm256_srli_epi32(s, 1), _mm256_srli_epi32(s, 2)));
+            const __m256i misfit = _mm256_and_si256(_mm256_andnot_si256(free, _mm256_and_si256(notEqual, notLands)), lowBits);
+            const __m256i fits = _mm256_and_si256(_mm256_cmpeq_epi32(misfit, _mm256_setzero_si256()), _mm256_cmpgt_epi32(sizes, indices));
+            const unsigned bits = _mm256_movemask_ps(_mm256_castsi256_ps(fits));
+            fitting[k / 64] |= std::uint64_t{bits} << (k % 64);
+        }
+    }
+#endif
+
+#if defined(__SSE2__)
+    void fitSse2(const std::uint32_t *edges, const std::uint32_t *signatures, const std::int32_t *frontierSizes,
+                 int index, int games, std::uint64_t *fitting)
+    {
+        const __m128i lowBits = _mm_set1_epi32(SIDE_LOW_BITS);
+        const __m128i indices = _mm_set1_epi32(index);
+        for (int k = 0; k < games; k += 4)
+        {
+            const __m128i e = _mm_loadu_si128(reinterpret_cast<const __m128i *>(edges + k));
+            const __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i *>(signatures + k));
+            const __m128i sizes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(frontierSizes + k));
+            const __m128i diff = _mm_xor_si128(e, s);
+            const __m128i notEqual = _mm_or_si128(diff, _mm_or_si128(_mm_srli_epi32(diff, 1), _mm_srli_epi32(diff, 2)));
+            const __m128i notLands = _mm_srli_epi32(_mm_or_si128(e, s), 2);
+            const __m128i free = _mm_and_si128(s, _mm_and_si128(_mm_srli_epi32(s, 1), _mm_srli_epi32(s, 2)));
+            const __m128i misfit = _mm_and_si128(_mm_andnot_si128(free, _mm_and_si128(notEqual, notLands)), lowBits);
+            const __m128i fits = _mm_and_si128(_mm_cmpeq_epi32(misfit, _mm_setzero_si128()), _mm_cmpgt_epi32(sizes, indices));
+            const unsigned bits = _mm_movemask_ps(_mm_castsi128_ps(fits));
+            fitting[k / 64] |= std::uint64_t{bits} << (k % 64);
+        }
+    }
+#endif
+
+    struct Kernel
+    {
+        const char *name;
+        FitKernel fit;
+    };
+
+    Kernel selectKernel()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+        {
+            return Kernel{"avx2", fitAvx2};
+        }
+#endif
+#if defined(__SSE2__)
+        return Kernel{"sse2", fitSse2};
+#else
+        return Kernel{"scalar", fitScalar};
+#endif
+    }
+
+    const Kernel &getKernel()
+    {
+        static const Kernel kernel = selectKernel();
+        return kernel;
+    }
+}
+
+BatchPlayout::BatchPlayout(const Game &game, int games, unsigned seed, bool vectorized)
+    : m_rng(seed), m_vectorized(vectorized)
+{
+    const Playout initial = Playout::fromGame(game);
+    m_games.assign(games, initial);
+    for (Playout &playout : m_games)
+    {
+        playout.shuffleRemainingTiles(m_rng);
+    }
+    m_running.assign(games, true);
+    // Padding lanes keep a frontier size of 0, so they never fit.
+    m_stride = (games + MAX_LANES - 1) / MAX_LANES * MAX_LANES;
+    for (auto &edges : m_drawnEdges)
+    {
+        edges.assign(m_stride, 0);
+    }
+    m_frontierSizes.assign(m_stride, 0);
+    m_scratchMoves.resize(games);
+    m_scratchFitting.resize((m_stride + 63) / 64);
+    reserveFrontier(initial.getFrontierSize());
+    for (int k = 0; k < games; k++)
+    {
+        for (int i = 0; i < initial.getFrontierSize(); i++)
+        {
+            syncFrontierCell(k, i);
+        }
+    }
+}
+
+const char *BatchPlayout::getKernelName()
+{
+    return getKernel().name;
+}
+
+void BatchPlayout::getFittingGames(int index, int rotation, std::vector<std::uint64_t> &fitting) const
+{
+    fitting.assign((m_stride + 63) / 64, 0);
+    if (index >= m_capacity)
+    {
+        return;
+    }
+    const std::uint32_t *edges = m_drawnEdges[rotation].data();
+    const std::uint32_t *signatures = m_signatures.data() + static_cast<std::size_t>(index) * m_stride;
+    if (m_vectorized)
+    {
+        getKernel().fit(edges, signatures, m_frontierSizes.data(), index, m_stride, fitting.data());
+    }
+    else
+    {
+        fitScalar(edges, signatures, m_frontierSizes.data(), index, m_stride, fitting.data());
+    }
+}
+
+int BatchPlayout::playDrawnTiles()
+{
+    const int maxFrontierSize = *std::max_element(m_frontierSizes.begin(), m_frontierSizes.end());
+    for (auto &moves : m_scratchMoves)
+    {
+        moves.clear();
+    }
+    for (int index = 0; index < maxFrontierSize; index++)
+    {
+        for (int rotation = 0; rotation < Tile::ROTATIONS; rotation++)
+        {
+            getFittingGames(index, rotation, m_scratchFitting);
+            for (int word = 0; word < static_cast<int>(m_scratchFitting.size()); word++)
+            {
+                for (std::uint64_t bits = m_scratchFitting[word]; bits != 0; bits &= bits - 1)
+                {
+                    const int k = 64 * word + __builtin_ctzll(bits);
+                    const Playout &playout = m_games[k];
+                    if (!playout.isDrawnTileTask() || playout.isLegalAtFrontier(index, rotation))
+                    {
+                        m_scratchMoves[k].emplace_back(index, rotation);
+                    }
+                }
+            }
+        }
+    }
+
+    int placed = 0;
+    for (int k = 0; k < getGamesCount(); k++)
+    {
+        Playout &playout = m_games[k];
+        if (!m_running[k] || !playout.hasDrawnTile())
+        {
+            continue;
+        }
+        m_frontierSizes[k] = 0;
+        if (playout.getPlacedTilesCount() == 0)
+        {
+            // The first tile goes to the empty board, which has no frontier yet.
+            m_running[k] = playout.playRandomMove(m_rng);
+            reserveFrontier(playout.getFrontierSize());
+            for (int i = 0; i < playout.getFrontierSize(); i++)
+            {
+                syncFrontierCell(k, i);
+            }
+            placed += m_running[k];
+            continue;
+        }
+        const auto &moves = m_scratchMoves[k];
+        if (moves.empty())
+        {
+            m_running[k] = false;
+            continue;
+        }
+        const auto [index, rotation] = moves[std::uniform_int_distribution<int>(0, moves.size() - 1)(m_rng)];
+        const CellId position = playout.getFrontierCell(index);
+        playout.placeAtFrontier(index, rotation);
+        syncAfterPlacing(k, position, index);
+        placed++;
+    }
+    return placed;
+}
+
+long long BatchPlayout::playToEnd()
+{
+    long long placed = 0;
+    while (const int moves = playRandomMoves())
+    {
+        placed += moves;
+    }
+    return placed;
+}
+
+bool BatchPlayout::drawNextTiles()
+{
+    bool anyRunning = false;
+    for (int k = 0; k < getGamesCount(); k++)
+    {
+        Playout &playout = m_games[k];
+        if (!m_running[k] || !playout.drawNextTile(m_rng))
+        {
+            m_running[k] = false;
+            m_frontierSizes[k] = 0;
+            continue;
+        }
+        for (int rotation = 0; rotation < Tile::ROTATIONS; rotation++)
+        {
+            m_drawnEdges[rotation][k] = playout.getDrawnEdges(rotation);
+        }
+        m_frontierSizes[k] = playout.getFrontierSize();
+        anyRunning = true;
+    }
+    return anyRunning;
+}
+
+void BatchPlayout::reserveFrontier(int cells)
+{
+    if (cells <= m_capacity)
+    {
+        return;
+    }
+    int capacity = std::max(MIN_FRONTIER_CAPACITY, 2 * m_capacity);
+    while (capacity < cells)
+    {
+        capacity *= 2;
+    }
+    // Rows are frontier indices, so growing keeps the existing cells in place.
+    m_signatures.resize(static_cast<std::size_t>(capacity) * m_stride, Board::FREE_SIGNATURE);
+    m_capacity = capacity;
+}
+
+void BatchPlayout::syncFrontierCell(int game, int index)
+{
+    m_signatures[static_cast<std::size_t>(index) * m_stride + game] = m_games[game].getFrontierSignature(index);
+}
+
+void BatchPlayout::syncAfterPlacing(int game, CellId placed, int coveredIndex)
+{
+    // Only the covered index, which now holds the former last cell, and the neighbors of the placed tile change.
+    const Playout &playout = m_games[game];
+    reserveFrontier(playout.getFrontierSize());
+    if (coveredIndex < playout.getFrontierSize())
+    {
+        syncFrontierCell(game, coveredIndex);
+    }
+    for (CellId neighbor : Board::getPotentialNeighbors(placed))
+    {
+        const int index = playout.getFrontierIndex(neighbor);
+        if (index >= 0)
+        {
+            syncFrontierCell(game, index);
+        }
+    }
+}
@@ -1,9 +1,16 @@
 #include "board.h"
+#include "internal.h"
 
 #include <algorithm>
 #include <cassert>
 #include <ostream>
-#include <set>
+#include <sstream>
+#include <tuple>
+
+namespace
+{
+    constexpr std::uint64_t NO_TASK = 7; // after the terrains
+}
 
 auto Board::getPotentialNeighbors(CellId id) -> std::array<CellId, Tile::ROTATIONS>
 {
@@ -16,7 +23,7 @@ auto Board::getPotentialNeighbors(CellId id) -> std::array<CellId, Tile::ROTATIO
     }
     else
     {
-        deltas = std::array<CellId, Tile::ROTATIONS>{{{-1, 0}, {0, 1}, {1, 0}, {1, 1}, {0, 1}, {-1, 1}}};
+        deltas = std::array<CellId, Tile::ROTATIONS>{{{-1, 0}, {0, -1}, {1, 0}, {1, 1}, {0, 1}, {-1, 1}}};
     }
     for (auto &delta : deltas)
     {
@@ -32,6 +39,82 @@ bool Board::areNeighbors(CellId lhs, CellId rhs)
                        { return id == rhs; });
 }
 
+auto Board::toAxial(CellId id) -> std::pair<int, int>
+{
+    // https://www.redblobgames.com/grids/hexagons/#conversions-offset
+    return std::make_pair(id.x, id.y - (id.x - (id.x & 1)) / 2);
+}
+
+CellId Board::fromAxial(int q, int r)
+{
+    return CellId{q, r + (q - (q & 1)) / 2};
+}
+
+CellId Board::transformCell(CellId id, int symmetry)
+{
+    // In cube coordinates (q, r, s = -q - r), the mirror swaps r and s, a clockwise rotation maps (q, r, s) to (-r, -s, -q).
+    auto [q, r] = toAxial(id);
+    if (symmetry >= Tile::ROTATIONS)
+    {
+        r = -q - r;
+    }
+    for (int step = 0; step < symmetry % Tile::ROTATIONS; step++)
+    {
+        std::tie(q, r) = std::make_pair(-r, q + r);
+    }
+    return fromAxial(q, r);
+}
+
+int Board::transformDirection(int absoluteDirection, int symmetry)
+{
+    const int mirrored = symmetry >= Tile::ROTATIONS ? Tile::ROTATIONS - 1 - absoluteDirection : absoluteDirection;
+    return (mirrored + symmetry) % Tile::ROTATIONS;
+}
+
+auto Board::transformEdges(const PlacedTile &placed, int symmetry) -> std::array<Terrain, Tile::ROTATIONS>
+{
+    std::array<Terrain, Tile::ROTATIONS> edges;
+    for (int direction = 0; direction < Tile::ROTATIONS; direction++)
+    {
+        edges[transformDirection(direction, symmetry)] = placed.getEdgeTowards(direction);
+    }
+    return edges;
+}
+
+auto Board::getCanonicalHash() const -> std::uint64_t
+{
+    return m_symmetryHashes[getCanonicalSymmetry()];
+}
+
+int Board::getCanonicalSymmetry() const
+{
+    return std::min_element(m_symmetryHashes.begin(), m_symmetryHashes.begin() + Tile::ROTATIONS) - m_symmetryHashes.begin();
+}
+
+auto Board::getMirroredCanonicalHash() const -> std::uint64_t
+{
+    return *std::min_element(m_symmetryHashes.begin() + Tile::ROTATIONS, m_symmetryHashes.end());
+}
+
+void Board::toggleSymmetryHashes(const PlacedTile &placed)
+{
+    // XOR makes the hashes independent of the order of placement, and removing a tile undoes placing it.
+    const std::uint64_t task = placed.tile.isTask() ? static_cast<std::uint64_t>(placed.tile.getTask()) : NO_TASK;
+    for (int symmetry = 0; symmetry < SYMMETRIES; symmetry++)
+    {
+        const auto [q, r] = toAxial(transformCell(placed.id, symmetry));
+        std::uint64_t key = task << 58 |
+                            (static_cast<std::uint64_t>(static_cast<std::uint32_t>(q)) & 0xfffff) << 38 |
+                            (static_cast<std::uint64_t>(static_cast<std::uint32_t>(r)) & 0xfffff) << 18;
+        const auto edges = transformEdges(placed, symmetry);
+        for (int direction = 0; direction < Tile::ROTATIONS; direction++)
+        {
+            key |= static_cast<std::uint64_t>(edges[direction]) << (3 * direction);
+        }
+        m_symmetryHashes[symmetry] ^= splitmix64(key);
+    }
+}
+
 auto Board::getEdge(CellId adjacent1, CellId adjacent2) -> std::pair<int, int>
 {
     auto neighbors = getPotentialNeighbors(adjacent1);
@@ -61,13 +144,102 @@ PlacedTile Board::getTileAt(CellId id) const
 void Board::putAt(CellId id, const Tile &tile, int rotation)
 {
     assert(!hasTileAt(id));
-    m_tiles.insert(std::make_pair(id, PlacedTile{tile, id, rotation}));
+    setSignature(id, FREE_SIGNATURE);
+    const PlacedTile &placed = m_tiles.insert(std::make_pair(id, PlacedTile{tile, id, rotation})).first->second;
+    toggleSymmetryHashes(placed);
+    auto neighbors = getPotentialNeighbors(id);
+    for (int direction = 0; direction < Tile::ROTATIONS; direction++)
+    {
+        if (!hasTileAt(neighbors[direction]))
+        {
+            const int opposite = (direction + Tile::ROTATIONS / 2) % Tile::ROTATIONS;
+            const auto edge = static_cast<std::uint32_t>(placed.getEdgeTowards(direction));
+            setSignature(neighbors[direction], withSide(getSignature(neighbors[direction]), opposite, edge));
+        }
+    }
 }
 
 void Board::removeAt(CellId id)
 {
     assert(hasTileAt(id));
+    toggleSymmetryHashes(getTileAt(id));
     m_tiles.erase(id);
+    ConstraintSignature signature = FREE_SIGNATURE;
+    auto neighbors = getPotentialNeighbors(id);
+    for (int direction = 0; direction < Tile::ROTATIONS; direction++)
+    {
+        const int opposite = (direction + Tile::ROTATIONS / 2) % Tile::ROTATIONS;
+        if (hasTileAt(neighbors[direction]))
+        {
+            const auto edge = static_cast<std::uint32_t>(getTileAt(neighbors[direction]).getEdgeTowards(opposite));
+            signature = withSide(signature, direction, edge);
+        }
+        else
+        {
+            setSignature(neighbors[direction], withSide(getSignature(neighbors[direction]), opposite, FREE_SIDE));
+        }
+    }
+    setSignature(id, signature);
+}
+
+void Board::rebindTiles(const std::function<const Tile &(const Tile &)> &rebind)
+{
+    // PlacedTile holds a reference, so the entries are rebuilt instead of assigned.
+    std::unordered_map<CellId, PlacedTile> tiles;
+    tiles.reserve(m_tiles.size());
+    for (const auto &[id, placed] : m_tiles)
+    {
+        tiles.emplace(id, PlacedTile{rebind(placed.tile), id, placed.rotation});
+    }
+    m_tiles = std::move(tiles);
+}
+
+auto Board::getSignature(CellId id) const -> ConstraintSignature
+{
+    auto it = m_frontier.find(id);
+    return it == m_frontier.end() ? FREE_SIGNATURE : it->second;
+}
+
+void Board::setSignature(CellId id, ConstraintSignature signature)
+{
+    // Moves the cell to the group of its new signature. A cell without neighbors leaves the frontier.
+    if (auto it = m_frontier.find(id); it != m_frontier.end())
+    {
+        if (it->second == signature)
+        {
+            return;
+        }
+        auto oldGroup = m_frontierGroups.find(it->second);
+        auto &oldCells = oldGroup->second;
+        oldCells.erase(std::lower_bound(oldCells.begin(), oldCells.end(), id));
+        if (oldCells.empty())
+        {
+            m_frontierGroups.erase(oldGroup);
+        }
+        m_frontier.erase(it);
+    }
+    if (signature == FREE_SIGNATURE)
+    {
+        return;
+    }
+    auto &cells = m_frontierGroups[signature];
+    cells.insert(std::upper_bound(cells.begin(), cells.end(), id), id);
+    m_frontier.emplace(id, signature);
+}
+
+auto Board::getSide(ConstraintSignature signature, int absoluteDirection) -> std::optional<Terrain>
+{
+    const std::uint32_t side = (signature >> (3 * absoluteDirection)) & FREE_SIDE;
+    if (side == FREE_SIDE)
+    {
+        return std::nullopt;
+    }
+    return static_cast<Terrain>(side);
+}
+
+auto Board::withSide(ConstraintSignature signature, int absoluteDirection, std::uint32_t side) -> ConstraintSignature
+{
+    return (signature & ~(FREE_SIDE << (3 * absoluteDirection))) | (side << (3 * absoluteDirection));
 }
 
 auto Board::getNeighbors(CellId id) const -> std::vector<PlacedTile>
@@ -108,19 +280,23 @@ auto Board::getEmptyNeighbors(CellId id) const -> std::vector<CellId>
 
 auto Board::getPlacesForNextTile() const -> std::vector<CellId>
 {
-    std::set<CellId> places;
-    for (const auto &it : m_tiles)
+    std::vector<CellId> places;
+    places.reserve(m_frontier.size());
+    for (const auto &it : m_frontier)
     {
-        for (const CellId pos : getEmptyNeighbors(it.first))
-        {
-            places.insert(pos);
-        }
+        places.push_back(it.first);
     }
     if (places.empty()) // no tiles, first move?
     {
-        places.insert(CellId{0, 0});
+        places.push_back(CellId{0, 0});
     }
-    return std::vector<CellId>(places.begin(), places.end());
+    std::sort(places.begin(), places.end());
+    return places;
+}
+
+Terrain PlacedTile::getEdgeTowards(int absoluteDirection) const
+{
+    return tile.getEdgeAt((absoluteDirection + Tile::ROTATIONS - rotation) % Tile::ROTATIONS);
 }
 
 bool CellId::operator==(const CellId &other) const
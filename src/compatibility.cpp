@@ -0,0 +1,186 @@
+#include "compatibility.h"
+#include "internal.h"
+
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+    const char CACHE_MAGIC[8] = {'D', 'O', 'R', 'F', 'C', 'M', 'P', '1'};
+
+    // Stored in the host byte order; a cache copied to a machine of the other endianness gets rebuilt.
+    struct CacheHeader
+    {
+        char magic[8];
+        std::uint64_t tilesetHash;
+        std::uint32_t tilesCount;
+        std::uint32_t wordsCount;
+        std::uint64_t byteOrderMark;
+    };
+    constexpr std::uint64_t BYTE_ORDER_MARK = 0x0102030405060708ull;
+
+    int wordsForTiles(int tilesCount)
+    {
+        return (tilesCount + 7) / 8;
+    }
+
+    std::size_t getBitsetsSize(int wordsCount)
+    {
+        return static_cast<std::size_t>(Tile::ROTATIONS) * CompatibilityMatrix::TERRAINS * wordsCount;
+    }
+
+    std::uint64_t fnv1a(std::uint64_t hash, std::uint8_t byte)
+    {
+        return (hash ^ byte) * 0x100000001b3ull;
+    }
+}
+
+auto CompatibilityMatrix::build(const std::vector<Tile> &catalog) -> std::shared_ptr<const CompatibilityMatrix>
+{
+    std::shared_ptr<CompatibilityMatrix> matrix(new CompatibilityMatrix());
+    matrix->m_tilesCount = catalog.size();
+    matrix->m_wordsCount = wordsForTiles(catalog.size());
+    matrix->m_tilesetHash = hashTileset(catalog);
+    matrix->m_owned.assign(getBitsetsSize(matrix->m_wordsCount), 0);
+    for (int direction = 0; direction < Tile::ROTATIONS; direction++)
+    {
+        for (int terrain = 0; terrain < TERRAINS; terrain++)
+        {
+            std::uint64_t *bitset = matrix->m_owned.data() + (direction * TERRAINS + terrain) * matrix->m_wordsCount;
+            for (int i = 0; i < static_cast<int>(catalog.size()); i++)
+            {
+                for (int rotation = 0; rotation < Tile::ROTATIONS; rotation++)
+                {
+                    const Terrain edge = catalog[i].getEdgeAt((direction + Tile::ROTATIONS - rotation) % Tile::ROTATIONS);
+                    if (areTerrainsCompatible(edge, static_cast<Terrain>(terrain)))
+                    {
+                        const int bit = 8 * i + rotation;
+                        bitset[bit / 64] |= std::uint64_t{1} << (bit % 64);
+                    }
+                }
+            }
+        }
+    }
+    matrix->m_bits = matrix->m_owned.data();
+    return matrix;
+}
+
+auto CompatibilityMatrix::loadOrBuild(const std::vector<Tile> &catalog, const std::string &tilesYamlPath) -> std::shared_ptr<const CompatibilityMatrix>
+{
+    const std::uint64_t tilesetHash = hashTileset(catalog);
+    const std::string cachePath = getCachePath(tilesYamlPath, tilesetHash);
+    if (auto mapped = map(cachePath, tilesetHash, catalog.size()))
+    {
+        return mapped;
+    }
+    auto built = build(catalog);
+    try
+    {
+        built->save(cachePath);
+    }
+    catch (const std::runtime_error &)
+    {
+        // The cache is only an optimization, e.g. the tiles may live in a read-only directory.
+    }
+    return built;
+}
+
+std::uint64_t CompatibilityMatrix::hashTileset(const std::vector<Tile> &catalog)
+{
+    std::uint64_t hash = 0xcbf29ce484222325ull;
+    for (const Tile &tile : catalog)
+    {
+        for (int i = 0; i < Tile::ROTATIONS; i++)
+        {
+            hash = fnv1a(hash, static_cast<std::uint8_t>(tile.getEdgeAt(i)));
+        }
+        hash = fnv1a(hash, tile.isTask() ? static_cast<std::uint8_t>(tile.getTask()) : 0xff);
+    }
+    return hash;
+}
+
+std::string CompatibilityMatrix::getCachePath(const std::string &tilesYamlPath, std::uint64_t tilesetHash)
+{
+    std::ostringstream oss;
+    oss << tilesYamlPath << "." << std::hex << std::setw(16) << std::setfill('0') << tilesetHash << ".compat";
+    return oss.str();
+}
+
+CompatibilityMatrix::~CompatibilityMatrix()
+{
+    if (m_mapping)
+    {
+        munmap(m_mapping, m_mappingSize);
+    }
+}
+
+auto CompatibilityMatrix::getBitset(int absoluteDirection, Terrain neighborEdge) const -> const std::uint64_t *
+{
+    return m_bits + (absoluteDirection * TERRAINS + static_cast<int>(neighborEdge)) * m_wordsCount;
+}
+
+std::uint8_t CompatibilityMatrix::getRotations(int catalogIndex, int absoluteDirection, Terrain neighborEdge) const
+{
+    const std::uint64_t word = getBitset(absoluteDirection, neighborEdge)[catalogIndex / 8];
+    return (word >> (8 * (catalogIndex % 8))) & 0x3f;
+}
+
+auto CompatibilityMatrix::map(const std::string &path, std::uint64_t tilesetHash, int tilesCount) -> std::shared_ptr<const CompatibilityMatrix>
+{
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return nullptr;
+    }
+    struct stat st;
+    const int wordsCount = wordsForTiles(tilesCount);
+    const std::size_t expectedSize = sizeof(CacheHeader) + getBitsetsSize(wordsCount) * sizeof(std::uint64_t);
+    if (fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) != expectedSize)
+    {
+        close(fd);
+        return nullptr;
+    }
+    void *mapping = mmap(nullptr, expectedSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        return nullptr;
+    }
+    CacheHeader header;
+    std::memcpy(&header, mapping, sizeof(header));
+    if (std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 || header.byteOrderMark != BYTE_ORDER_MARK ||
+        header.tilesetHash != tilesetHash || static_cast<int>(header.tilesCount) != tilesCount ||
+        static_cast<int>(header.wordsCount) != wordsCount)
+    {
+        munmap(mapping, expectedSize);
+        return nullptr;
+    }
+    std::shared_ptr<CompatibilityMatrix> matrix(new CompatibilityMatrix());
+    matrix->m_tilesCount = tilesCount;
+    matrix->m_wordsCount = wordsCount;
+    matrix->m_tilesetHash = tilesetHash;
+    matrix->m_mapping = mapping;
+    matrix->m_mappingSize = expectedSize;
+    matrix->m_bits = reinterpret_cast<const std::uint64_t *>(static_cast<const char *>(mapping) + sizeof(CacheHeader));
+    return matrix;
+}
+
+void CompatibilityMatrix::save(const std::string &path) const
+{
+    CacheHeader header;
+    std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.tilesetHash = m_tilesetHash;
+    header.tilesCount = m_tilesCount;
+    header.wordsCount = m_wordsCount;
+    header.byteOrderMark = BYTE_ORDER_MARK;
+
+    writeFileAtomically(path, {{&header, sizeof(header)}, {m_bits, getBitsetsSize(m_wordsCount) * sizeof(std::uint64_t)}},
+                        "compatibility cache");
+}
@@ -0,0 +1,180 @@
+#include "farm_protocol.h"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <unistd.h>
+
+namespace
+{
+    struct FrameHeader
+    {
+        std::uint32_t type;
+        std::uint32_t size;
+    };
+
+    constexpr std::size_t REPLAY_HEADER_SIZE = 3 * sizeof(std::uint32_t); // seed, finished tasks, moves count
+    constexpr std::size_t REPLAY_MOVE_SIZE = 2 * sizeof(std::int16_t) + 2;
+
+    void writeAll(int fd, const char *data, std::size_t size)
+    {
+        while (size > 0)
+        {
+            const ssize_t written = write(fd, data, size);
+            if (written < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (written <= 0)
+            {
+                throw std::runtime_error(std::string("cannot write farm message: ") + std::strerror(errno));
+            }
+            data += written;
+            size -= written;
+        }
+    }
+
+    // Returns the number of bytes read, which is less than size only at the end of the stream.
+    std::size_t readAll(int fd, char *data, std::size_t size)
+    {
+        std::size_t done = 0;
+        while (done < size)
+        {
+            const ssize_t got = read(fd, data + done, size - done);
+            if (got < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (got < 0)
+            {
+                throw std::runtime_error(std::string("cannot read farm message: ") + std::strerror(errno));
+            }
+            if (got == 0)
+            {
+                break;
+            }
+            done += got;
+        }
+        return done;
+    }
+
+    template <class T>
+    void put(std::vector<char> &out, T value)
+    {
+        const char *bytes = reinterpret_cast<const char *>(&value);
+        out.insert(out.end(), bytes, bytes + sizeof(T));
+    }
+
+    template <class T>
+    T take(const std::vector<char> &in, std::size_t &offset)
+    {
+        if (offset + sizeof(T) > in.size())
+        {
+            throw std::runtime_error("truncated farm message payload");
+        }
+        T value;
+        std::memcpy(&value, in.data() + offset, sizeof(T));
+        offset += sizeof(T);
+        return value;
+    }
+}
+
+void writeMessage(int fd, FarmMessageType type, const std::vector<char> &payload)
+{
+    if (payload.size() > MAX_FARM_PAYLOAD_SIZE)
+    {
+        throw std::runtime_error("farm message payload is too large");
+    }
+    // One buffer and one write, so that a message is never interleaved with another writer's.
+    std::vector<char> frame;
+    frame.reserve(sizeof(FrameHeader) + payload.size());
+    put(frame, FrameHeader{static_cast<std::uint32_t>(type), static_cast<std::uint32_t>(payload.size())});
+    frame.insert(frame.end(), payload.begin(), payload.end());
+    writeAll(fd, frame.data(), frame.size());
+}
+
+bool readMessage(int fd, FarmMessage &message)
+{
+    FrameHeader header;
+    const std::size_t got = readAll(fd, reinterpret_cast<char *>(&header), sizeof(header));
+    if (got == 0)
+    {
+        return false;
+    }
+    if (got < sizeof(header))
+    {
+        throw std::runtime_error("farm stream ended inside a message header");
+    }
+    if (header.size > MAX_FARM_PAYLOAD_SIZE)
+    {
+        throw std::runtime_error("farm message payload is too large");
+    }
+    if (header.type < static_cast<std::uint32_t>(FarmMessageType::Hello) || header.type > static_cast<std::uint32_t>(FarmMessageType::Stop))
+    {
+        throw std::runtime_error("unknown farm message type " + std::to_string(header.type));
+    }
+    message.type = static_cast<FarmMessageType>(header.type);
+    message.payload.resize(header.size);
+    if (readAll(fd, message.payload.data(), header.size) < header.size)
+    {
+        throw std::runtime_error("farm stream ended inside a message payload");
+    }
+    return true;
+}
+
+auto encodeJob(const FarmJob &job) -> std::vector<char>
+{
+    std::vector<char> payload;
+    put(payload, job.firstSeed);
+    put(payload, job.games);
+    return payload;
+}
+
+auto decodeJob(const std::vector<char> &payload) -> FarmJob
+{
+    std::size_t offset = 0;
+    FarmJob job;
+    job.firstSeed = take<std::uint32_t>(payload, offset);
+    job.games = take<std::uint32_t>(payload, offset);
+    return job;
+}
+
+auto encodeReplay(const ReplayRecord &record) -> std::vector<char>
+{
+    std::vector<char> payload;
+    payload.reserve(REPLAY_HEADER_SIZE + record.moves.size() * REPLAY_MOVE_SIZE);
+    put(payload, record.seed);
+    put(payload, record.finishedTasks);
+    put(payload, static_cast<std::uint32_t>(record.moves.size()));
+    for (const ReplayMove &move : record.moves)
+    {
+        put(payload, move.x);
+        put(payload, move.y);
+        put(payload, move.rotation);
+        put(payload, move.taskSize);
+    }
+    return payload;
+}
+
+auto decodeReplay(const std::vector<char> &payload) -> ReplayRecord
+{
+    std::size_t offset = 0;
+    ReplayRecord record;
+    record.seed = take<std::uint32_t>(payload, offset);
+    record.finishedTasks = take<std::int32_t>(payload, offset);
+    const auto movesCount = take<std::uint32_t>(payload, offset);
+    if (movesCount != (payload.size() - offset) / REPLAY_MOVE_SIZE || (payload.size() - offset) % REPLAY_MOVE_SIZE != 0)
+    {
+        throw std::runtime_error("farm replay payload does not match its moves count");
+    }
+    record.moves.resize(movesCount);
+    for (ReplayMove &move : record.moves)
+    {
+        move.x = take<std::int16_t>(payload, offset);
+        move.y = take<std::int16_t>(payload, offset);
+        move.rotation = take<std::uint8_t>(payload, offset);
+        move.taskSize = take<std::uint8_t>(payload, offset);
+    }
+    return record;
+}
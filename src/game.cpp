@@ -2,6 +2,8 @@
 
 #include <algorithm>
 #include <cassert>
+#include <functional>
+#include <map>
 #include <sstream>
 #include <unordered_set>
 #include <queue>
@@ -10,6 +12,17 @@
 
 namespace
 {
+    // The tile at the same index of `to`, or nullptr when the tile is not in `from`.
+    const Tile *findCopiedTile(const Tile &tile, const std::vector<Tile> &from, const std::vector<Tile> &to)
+    {
+        const std::less<const Tile *> before;
+        if (from.empty() || before(&tile, from.data()) || !before(&tile, from.data() + from.size()))
+        {
+            return nullptr;
+        }
+        return &to[&tile - from.data()];
+    }
+
     bool isAdjacentToBoard(const Board &b, CellId position)
     {
         auto neighbors = Board::getPotentialNeighbors(position);
@@ -31,8 +44,21 @@ namespace
         bool isClosed;
     };
 
-    SearchResult searchConnectedTiles(const Board &b, Terrain terrain, CellId startPosition)
+    // `extra` is a tile considered to be on the board without putting it there, so that the frontier stays untouched.
+    SearchResult searchConnectedTiles(const Board &b, Terrain terrain, CellId startPosition, const PlacedTile *extra = nullptr)
     {
+        auto getTileAt = [&b, extra](CellId position) -> std::optional<PlacedTile>
+        {
+            if (extra && extra->id == position)
+            {
+                return *extra;
+            }
+            if (b.hasTileAt(position))
+            {
+                return b.getTileAt(position);
+            }
+            return std::nullopt;
+        };
         std::queue<CellId> tilesToVisit;
         tilesToVisit.push(startPosition);
         std::unordered_set<CellId> visitedTiles;
@@ -42,17 +68,17 @@ namespace
         while (!tilesToVisit.empty())
         {
             CellId position = tilesToVisit.front();
-            PlacedTile tile = b.getTileAt(position);
+            PlacedTile tile = *getTileAt(position);
             tilesToVisit.pop();
             terrainSize++;
+            auto neighbors = Board::getPotentialNeighbors(position);
             for (int r = 0; r < Tile::ROTATIONS; r++)
             {
-                int edge = absoluteDirectionToTileDirection(r, tile.rotation);
-                if (tile.tile.getEdgeAt(edge) != terrain)
+                if (tile.getEdgeTowards(r) != terrain)
                 {
                     continue;
                 }
-                std::optional<PlacedTile> neighbor = b.getNeighbor(position, r);
+                std::optional<PlacedTile> neighbor = getTileAt(neighbors[r]);
                 if (!neighbor)
                 {
                     isClosed = false;
@@ -106,6 +132,7 @@ void Game::parseYamlTiles(const YAML::Node &rootNode, bool shuffle)
     for (const auto &tile : tiles)
     {
         auto the_tile = Tile::fromYaml(tile);
+        the_tile.setCatalogIndex(m_catalog.intern(the_tile));
         if (the_tile.isLand())
         {
             m_lands.push_back(the_tile);
@@ -115,6 +142,7 @@ void Game::parseYamlTiles(const YAML::Node &rootNode, bool shuffle)
             m_tasks.push_back(the_tile);
         }
     }
+    m_remainingCounts = m_catalog.getCounts();
     if (shuffle)
     {
         std::shuffle(m_lands.begin(), m_lands.end(), getRandomEngine());
@@ -144,29 +172,169 @@ int Game::fetchTaskSize(Terrain task)
     return taskSize;
 }
 
-std::vector<Move> Game::nextMoves()
+void Game::takeTaskSize(Terrain task, int taskSize)
+{
+    auto [beginIt, endIt] = m_freeTaskSizes.equal_range(task);
+    auto it = std::find_if(beginIt, endIt, [taskSize](const auto &item)
+                           { return item.second == taskSize; });
+    if (it == endIt)
+    {
+        std::ostringstream oss;
+        oss << "No " << task << " task of size " << taskSize << " left, but one was required.";
+        throw std::runtime_error(oss.str());
+    }
+    m_freeTaskSizes.erase(it);
+}
+
+bool Game::drawNextTile()
 {
+    if (getDrawnTile())
+    {
+        return true;
+    }
     auto optionalTile = takeNextTileToPlay();
     if (!optionalTile)
     {
-        return std::vector<Move>{}; // no tiles left to play, game over
+        return false; // no tiles left to play, game over
+    }
+    const Tile *tile = *optionalTile;
+    setDrawnTile(tile, tile->isTask() ? std::make_optional(fetchTaskSize(tile->getTask())) : std::nullopt);
+    return true;
+}
+
+void Game::drawNextTile(const ChanceOutcome &outcome)
+{
+    if (getDrawnTile())
+    {
+        throw std::runtime_error("a drawn tile has to be placed before drawing another one");
     }
-    Tile *nextTile = *optionalTile;
-    std::vector<CellId>
-        placesToPutTile = m_board.getPlacesForNextTile();
-    std::vector<Move> possibleMoves;
-    std::optional<int> taskSize = nextTile->isTask() ? std::make_optional(fetchTaskSize(nextTile->getTask())) : std::nullopt;
-    for (CellId position : placesToPutTile)
+    const Tile &type = m_catalog.getType(outcome.type);
+    if (type.isTask() != outcome.taskSize.has_value())
     {
-        for (int rotation = 0; rotation < Tile::ROTATIONS; rotation++)
+        throw std::runtime_error("a task size is required exactly for task tiles");
+    }
+    if (outcome.taskSize)
+    {
+        // Checked before the tile is taken, so that a wrong outcome leaves the game untouched.
+        auto [beginIt, endIt] = m_freeTaskSizes.equal_range(type.getTask());
+        if (std::none_of(beginIt, endIt, [&outcome](const auto &item)
+                         { return item.second == *outcome.taskSize; }))
         {
-            if (canPlaceTileAt(*nextTile, position, rotation, taskSize))
+            throw std::runtime_error("the task size of the outcome is not free");
+        }
+    }
+    const Tile *tile = takeTileToPlay(outcome.type);
+    if (outcome.taskSize)
+    {
+        takeTaskSize(tile->getTask(), *outcome.taskSize);
+    }
+    setDrawnTile(tile, outcome.taskSize);
+}
+
+auto Game::getDrawnTile() const -> Tile *
+{
+    if (m_drawnIndex < 0)
+    {
+        return nullptr;
+    }
+    // Moves hand out mutable tiles of the game, like takeNextTileToPlay.
+    const Tile &tile = (m_drawnIsTask ? m_tasks : m_lands)[m_drawnIndex];
+    return const_cast<Tile *>(&tile);
+}
+
+void Game::setDrawnTile(const Tile *tile, std::optional<int> taskSize)
+{
+    m_drawnIsTask = tile->isTask();
+    m_drawnIndex = (m_drawnIsTask ? m_nextTaskIndex : m_nextLandIndex) - 1;
+    assert(tile == &(m_drawnIsTask ? m_tasks : m_lands)[m_drawnIndex]);
+    m_drawnTaskSize = taskSize;
+}
+
+std::vector<Move> Game::nextMoves()
+{
+    if (!drawNextTile())
+    {
+        return std::vector<Move>{};
+    }
+    MoveGenerator moves = generateMoves();
+    return std::vector<Move>(moves.begin(), moves.end());
+}
+
+std::vector<Move> Game::nextMoves(const ChanceOutcome &outcome)
+{
+    drawNextTile(outcome);
+    MoveGenerator moves = generateMoves();
+    return std::vector<Move>(moves.begin(), moves.end());
+}
+
+auto MoveGenerator::begin() const -> Iterator
+{
+    Iterator it;
+    it.m_game = m_game;
+    if (!m_game->getDrawnTile())
+    {
+        return it;
+    }
+    it.m_done = false;
+    const Board &board = m_game->m_board;
+    if (board.isEmpty())
+    {
+        static const std::vector<CellId> origin{CellId{0, 0}};
+        it.m_group = board.getFrontierGroups().end();
+        it.enterGroup(Board::FREE_SIGNATURE, origin);
+    }
+    else
+    {
+        it.m_group = board.getFrontierGroups().begin();
+        it.enterGroup(it.m_group->first, it.m_group->second);
+    }
+    it.advance();
+    return it;
+}
+
+auto MoveGenerator::Iterator::operator++() -> Iterator &
+{
+    advance();
+    return *this;
+}
+
+void MoveGenerator::Iterator::enterGroup(ConstraintSignature signature, const std::vector<CellId> &cells)
+{
+    // Edge compatibility depends only on the signature of a cell, so it is checked once per group of cells.
+    m_cells = &cells;
+    m_cellIndex = 0;
+    m_rotation = 0;
+    m_rotations = m_game->getFittingRotations(*m_game->getDrawnTile(), signature);
+}
+
+void MoveGenerator::Iterator::advance()
+{
+    Tile *tile = m_game->getDrawnTile();
+    const std::optional<int> taskSize = m_game->m_drawnTaskSize;
+    const auto groupsEnd = m_game->m_board.getFrontierGroups().end();
+    while (true)
+    {
+        for (; m_rotations != 0 && m_cellIndex < static_cast<int>(m_cells->size()); m_cellIndex++, m_rotation = 0)
+        {
+            const CellId position = (*m_cells)[m_cellIndex];
+            while (m_rotation < Tile::ROTATIONS)
             {
-                possibleMoves.push_back(Move{nextTile, position, rotation, taskSize});
+                const int rotation = m_rotation++;
+                if ((m_rotations >> rotation & 1) && (!taskSize || m_game->keepsTasksPossible(*tile, position, rotation, *taskSize)))
+                {
+                    m_move = Move{tile, position, rotation, taskSize};
+                    return;
+                }
             }
         }
+        // The empty board has the single group at the origin, which is not among the frontier groups.
+        if (m_group == groupsEnd || ++m_group == groupsEnd)
+        {
+            m_done = true;
+            return;
+        }
+        enterGroup(m_group->first, m_group->second);
     }
-    return possibleMoves;
 }
 
 void Game::updateFinishedOrImpossibleTasks(CellId placedTileId)
@@ -196,46 +364,155 @@ void Game::updateFinishedOrImpossibleTasks(CellId placedTileId)
     m_currentTasks = std::move(stillUnfinishedTasks);
 }
 
-Game Game::fromYaml(const YAML::Node &rootNode, bool shuffle)
+void Game::parseYaml(const YAML::Node &rootNode, bool shuffle)
 {
-    Game game;
     if (rootNode.Type() != YAML::NodeType::Map)
     {
         throw std::runtime_error("expected map as a top-level yaml node");
     }
-    game.parseYamlTiles(rootNode, shuffle);
-    game.parseYamlTasks(rootNode);
+    parseYamlTiles(rootNode, shuffle);
+    parseYamlTasks(rootNode);
+}
+
+Game::Game(const Game &other)
+    : m_lands(other.m_lands),
+      m_nextLandIndex(other.m_nextLandIndex),
+      m_tasks(other.m_tasks),
+      m_nextTaskIndex(other.m_nextTaskIndex),
+      m_currentTasks(other.m_currentTasks),
+      m_finishedTasks(other.m_finishedTasks),
+      m_freeTaskSizes(other.m_freeTaskSizes),
+      m_board(other.m_board),
+      m_catalog(other.m_catalog),
+      m_remainingCounts(other.m_remainingCounts),
+      m_compatibility(other.m_compatibility),
+      m_drawnIsTask(other.m_drawnIsTask),
+      m_drawnIndex(other.m_drawnIndex),
+      m_drawnTaskSize(other.m_drawnTaskSize)
+{
+    auto ownTile = [this, &other](const Tile &tile) -> const Tile &
+    {
+        if (const Tile *land = findCopiedTile(tile, other.m_lands, m_lands))
+        {
+            return *land;
+        }
+        if (const Tile *task = findCopiedTile(tile, other.m_tasks, m_tasks))
+        {
+            return *task;
+        }
+        return tile;
+    };
+    m_board.rebindTiles(ownTile);
+}
+
+Game &Game::operator=(const Game &other)
+{
+    if (this != &other)
+    {
+        *this = Game(other);
+    }
+    return *this;
+}
+
+Game Game::fromYaml(const YAML::Node &rootNode, bool shuffle)
+{
+    return fromYaml(rootNode, nullptr, shuffle);
+}
+
+Game Game::fromYaml(const YAML::Node &rootNode, std::shared_ptr<const CompatibilityMatrix> compatibility, bool shuffle)
+{
+    Game game;
+    game.parseYaml(rootNode, shuffle);
+    if (!compatibility)
+    {
+        compatibility = CompatibilityMatrix::build(game.m_catalog.getTypes());
+    }
+    else if (compatibility->getTilesetHash() != CompatibilityMatrix::hashTileset(game.m_catalog.getTypes()))
+    {
+        throw std::runtime_error("the compatibility matrix was built for another tileset");
+    }
+    game.m_compatibility = std::move(compatibility);
     return game;
 }
 
-bool Game::canPlaceTileAt(const Tile &tile, CellId position, int rotation, std::optional<int> taskSize)
+auto Game::loadCompatibility(const YAML::Node &rootNode, const std::string &tilesYamlPath) -> std::shared_ptr<const CompatibilityMatrix>
 {
-    assert(isAdjacentToBoard(m_board, position) || m_board.isEmpty());
-    for (PlacedTile tile2 : m_board.getNeighbors(position))
-    {
-        auto [direction1, direction2] = m_board.getEdge(position, tile2.id);
-        int rotation1 = absoluteDirectionToTileDirection(direction1, rotation);
-        int rotation2 = absoluteDirectionToTileDirection(direction2, tile2.rotation);
-        auto terrain1 = tile.getEdgeAt(rotation1);
-        auto terrain2 = tile2.tile.getEdgeAt(rotation2);
-        if (!areTerrainsCompatible(terrain1, terrain2))
+    Game game;
+    game.parseYaml(rootNode, false);
+    if (tilesYamlPath.empty())
+    {
+        return CompatibilityMatrix::build(game.m_catalog.getTypes());
+    }
+    return CompatibilityMatrix::loadOrBuild(game.m_catalog.getTypes(), tilesYamlPath);
+}
+
+Game Game::fromYamlFile(const std::string &tilesYamlPath, bool shuffle)
+{
+    Game game;
+    game.parseYaml(YAML::LoadFile(tilesYamlPath), shuffle);
+    game.m_compatibility = CompatibilityMatrix::loadOrBuild(game.m_catalog.getTypes(), tilesYamlPath);
+    return game;
+}
+
+std::uint8_t Game::getFittingRotations(const Tile &tile, CellId position) const
+{
+    return getFittingRotations(tile, m_board.getSignature(position));
+}
+
+std::uint8_t Game::getFittingRotations(const Tile &tile, ConstraintSignature signature) const
+{
+    std::uint8_t rotations = (1 << Tile::ROTATIONS) - 1;
+    const bool useMatrix = m_compatibility && tile.getCatalogIndex() >= 0 && tile.getCatalogIndex() < m_compatibility->getTilesCount();
+    for (int direction = 0; direction < Tile::ROTATIONS && rotations != 0; direction++)
+    {
+        std::optional<Terrain> neighborEdge = Board::getSide(signature, direction);
+        if (!neighborEdge)
+        {
+            continue;
+        }
+        if (useMatrix)
+        {
+            rotations &= m_compatibility->getRotations(tile.getCatalogIndex(), direction, *neighborEdge);
+            continue;
+        }
+        for (int rotation = 0; rotation < Tile::ROTATIONS; rotation++)
         {
-            return false;
+            const Terrain edge = tile.getEdgeAt(absoluteDirectionToTileDirection(direction, rotation));
+            if (!areTerrainsCompatible(edge, *neighborEdge))
+            {
+                rotations &= ~(1 << rotation);
+            }
         }
     }
+    return rotations;
+}
+
+bool Game::canPlaceTileAt(const Tile &tile, CellId position, int rotation, std::optional<int> taskSize)
+{
+    assert(isAdjacentToBoard(m_board, position) || m_board.isEmpty());
+    if (!(getFittingRotations(tile, position) >> rotation & 1))
+    {
+        return false;
+    }
     if (!taskSize)
     {
         // A land can close even an unfinished task.
         return true;
     }
+    return keepsTasksPossible(tile, position, rotation, *taskSize);
+}
+
+bool Game::keepsTasksPossible(const Tile &tile, CellId position, int rotation, int taskSize) const
+{
     // Cannot put a task tile which would prevent a task from finishing.
     assert(tile.isTask());
-    m_board.putAt(position, tile, rotation);
-    m_currentTasks.push_back(Task{position, *taskSize, tile.getTask()});
+    const PlacedTile placed{tile, position, rotation};
+    std::vector<Task> tasks = m_currentTasks;
+    tasks.push_back(Task{position, taskSize, tile.getTask()});
     bool canPlace = true;
-    for (const Task &task : m_currentTasks)
+    for (const Task &task : tasks)
     {
-        SearchResult searchResult = searchConnectedTiles(m_board, task.terrain, task.position);
+        SearchResult searchResult = searchConnectedTiles(m_board, task.terrain, task.position, &placed);
         if (searchResult.terrainSize == task.size)
         {
             // task would be completed, ok
@@ -250,14 +527,17 @@ bool Game::canPlaceTileAt(const Tile &tile, CellId position, int rotation, std::
             // not completed, but not blocked
         }
     }
-    m_currentTasks.pop_back();
-    m_board.removeAt(position);
     return canPlace;
 }
 
 void Game::placeTileAt(const Tile &tile, CellId position, int rotation, std::optional<int> taskSize)
 {
     assert(canPlaceTileAt(tile, position, rotation));
+    if (&tile == getDrawnTile())
+    {
+        m_drawnIndex = -1;
+        m_drawnTaskSize.reset();
+    }
     m_board.putAt(position, tile, rotation);
     if (tile.isTask())
     {
@@ -275,15 +555,129 @@ void Game::makeMove(const Move &move)
     placeTileAt(*move.tile, move.position, move.rotation, move.taskSize);
 }
 
+int Game::getRemainingTilesCount() const
+{
+    int remainingTasks = static_cast<int>(m_tasks.size()) - m_nextTaskIndex;
+    int remainingLands = std::max(0, static_cast<int>(m_lands.size()) - UNUSED_LANDS - m_nextLandIndex);
+    return remainingTasks + remainingLands;
+}
+
+bool Game::drawsTaskNext() const
+{
+    return m_currentTasks.size() < MAX_CONCURRENT_TASKS && m_nextTaskIndex < static_cast<int>(m_tasks.size());
+}
+
 std::optional<Tile *> Game::takeNextTileToPlay()
 {
-    if (m_currentTasks.size() < MAX_CONCURRENT_TASKS && m_nextTaskIndex < static_cast<int>(m_tasks.size()))
+    Tile *tile = nullptr;
+    if (drawsTaskNext())
+    {
+        tile = &m_tasks.at(m_nextTaskIndex++);
+    }
+    else if (m_nextLandIndex < static_cast<int>(m_lands.size()) - UNUSED_LANDS)
+    {
+        tile = &m_lands.at(m_nextLandIndex++);
+    }
+    else
+    {
+        return std::nullopt; // No tiles left
+    }
+    if (tile->getCatalogIndex() >= 0)
+    {
+        m_remainingCounts.at(tile->getCatalogIndex())--;
+    }
+    return tile;
+}
+
+auto Game::takeTileToPlay(int type) -> Tile *
+{
+    const bool drawsTask = drawsTaskNext();
+    if (!drawsTask && m_nextLandIndex >= static_cast<int>(m_lands.size()) - UNUSED_LANDS)
+    {
+        throw std::runtime_error("no tiles left to play");
+    }
+    if (m_catalog.getType(type).isTask() != drawsTask)
+    {
+        throw std::runtime_error(drawsTask ? "a task tile must be played next" : "a land must be played next");
+    }
+    std::vector<Tile> &tiles = drawsTask ? m_tasks : m_lands;
+    int &nextIndex = drawsTask ? m_nextTaskIndex : m_nextLandIndex;
+    // Only the tiles before nextIndex are referenced by the board, so the remaining ones can be reordered.
+    auto it = std::find_if(tiles.begin() + nextIndex, tiles.end(), [type](const Tile &tile)
+                           { return tile.getCatalogIndex() == type; });
+    if (it == tiles.end())
     {
-        return &m_tasks.at(m_nextTaskIndex++);
+        throw std::runtime_error("no tiles of the type left");
     }
-    if (m_nextLandIndex < static_cast<int>(m_lands.size()) - UNUSED_LANDS)
+    std::iter_swap(tiles.begin() + nextIndex, it);
+    m_remainingCounts.at(type)--;
+    return &tiles.at(nextIndex++);
+}
+
+std::vector<TileOutcome> Game::getNextTileOutcomes() const
+{
+    // The same choice between a task and a land as in takeNextTileToPlay.
+    bool drawsTask;
+    int remaining;
+    if (drawsTaskNext())
     {
-        return &m_lands.at(m_nextLandIndex++);
+        drawsTask = true;
+        remaining = m_tasks.size() - m_nextTaskIndex;
+    }
+    else if (m_nextLandIndex < static_cast<int>(m_lands.size()) - UNUSED_LANDS)
+    {
+        drawsTask = false;
+        // The unused lands are unknown as well, so each remaining land may come next.
+        remaining = m_lands.size() - m_nextLandIndex;
+    }
+    else
+    {
+        return {};
+    }
+    std::vector<TileOutcome> outcomes;
+    for (int type = 0; type < m_catalog.getTypesCount(); type++)
+    {
+        if (m_remainingCounts[type] > 0 && m_catalog.getType(type).isTask() == drawsTask)
+        {
+            outcomes.push_back(TileOutcome{type, static_cast<double>(m_remainingCounts[type]) / remaining});
+        }
+    }
+    return outcomes;
+}
+
+std::vector<ChanceOutcome> Game::getChanceOutcomes() const
+{
+    if (getDrawnTile())
+    {
+        throw std::runtime_error("a drawn tile has to be placed before the next chance outcomes");
+    }
+    std::vector<ChanceOutcome> outcomes;
+    for (const TileOutcome &tileOutcome : getNextTileOutcomes())
+    {
+        const Tile &type = m_catalog.getType(tileOutcome.type);
+        if (type.isLand())
+        {
+            outcomes.push_back(ChanceOutcome{tileOutcome.type, std::nullopt, tileOutcome.probability});
+            continue;
+        }
+        // fetchTaskSize picks uniformly among the free entries, so equal sizes add up.
+        std::map<int, int> sizeCounts;
+        auto [beginIt, endIt] = m_freeTaskSizes.equal_range(type.getTask());
+        for (auto it = beginIt; it != endIt; it++)
+        {
+            sizeCounts[it->second]++;
+        }
+        if (sizeCounts.empty())
+        {
+            std::ostringstream oss;
+            oss << "No " << type.getTask() << " tasks left, but a " << type.getTask() << " task tile may come next.";
+            throw std::runtime_error(oss.str());
+        }
+        const int sizesCount = std::distance(beginIt, endIt);
+        for (const auto &[size, count] : sizeCounts)
+        {
+            outcomes.push_back(ChanceOutcome{tileOutcome.type, size, tileOutcome.probability * count / sizesCount});
+        }
     }
-    return std::nullopt; // No tiles left
+    return outcomes;
 }
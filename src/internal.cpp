@@ -0,0 +1,30 @@
+#include "internal.h"
+
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+
+#include <unistd.h>
+
+void writeFileAtomically(const std::string &path, const std::vector<std::pair<const void *, std::size_t>> &blocks,
+                         const std::string &description)
+{
+    const std::string temporaryPath = path + ".tmp" + std::to_string(getpid());
+    {
+        std::ofstream out(temporaryPath, std::ios::binary | std::ios::trunc);
+        for (const auto &[data, size] : blocks)
+        {
+            out.write(static_cast<const char *>(data), size);
+        }
+        if (!out)
+        {
+            std::remove(temporaryPath.c_str());
+            throw std::runtime_error("cannot write " + description + ": " + temporaryPath);
+        }
+    }
+    if (std::rename(temporaryPath.c_str(), path.c_str()) != 0)
+    {
+        std::remove(temporaryPath.c_str());
+        throw std::runtime_error("cannot rename " + description + " to " + path);
+    }
+}
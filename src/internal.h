@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Helpers shared by the translation units of the library; not part of its interface.
+
+// Mixes the bits of a key, for hashes combined with XOR.
+inline std::uint64_t splitmix64(std::uint64_t x)
+{
+    x += 0x9e3779b97f4a7c15ull;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+// Writes the blocks one after another to a temporary file next to path and renames it over path, so that a
+// process mapping the file never sees a half-written one. Throws std::runtime_error naming the description.
+void writeFileAtomically(const std::string &path, const std::vector<std::pair<const void *, std::size_t>> &blocks,
+                         const std::string &description);
@@ -28,8 +28,7 @@ namespace
 int main(int argc, char **argv)
 {
     Args args = parseArgs(argc, argv);
-    YAML::Node rootNode = YAML::LoadFile(args.tilesYamlPath);
-    Game game = Game::fromYaml(rootNode);
+    Game game = Game::fromYamlFile(args.tilesYamlPath);
     std::cout << "Game loaded! There are " << game.getLands().size() << " lands and " << game.getTasks().size() << " tasks." << std::endl;
     return 0;
 }
\ No newline at end of file
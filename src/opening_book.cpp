@@ -0,0 +1,178 @@
+#include "opening_book.h"
+#include "internal.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+    const char BOOK_MAGIC[8] = {'D', 'O', 'R', 'F', 'B', 'O', 'O', 'K'};
+    constexpr std::uint32_t BOOK_VERSION = 1;
+    constexpr std::uint32_t NO_TASK = 7;
+
+    // Stored in the host byte order, like the compatibility cache.
+    struct BookHeader
+    {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t entrySize;
+        std::uint64_t entriesCount;
+        std::uint64_t byteOrderMark;
+    };
+    constexpr std::uint64_t BYTE_ORDER_MARK = 0x0102030405060708ull;
+
+    std::uint32_t packEdges(const std::array<Terrain, Tile::ROTATIONS> &edges)
+    {
+        std::uint32_t packed = 0;
+        for (int direction = 0; direction < Tile::ROTATIONS; direction++)
+        {
+            packed |= static_cast<std::uint32_t>(edges[direction]) << (3 * direction);
+        }
+        return packed;
+    }
+
+    // The drawn tile can still be placed in any rotation, so only its edges up to a rotation matter.
+    std::uint32_t getRotationFreeEdges(std::uint32_t edges)
+    {
+        std::uint32_t smallest = edges;
+        for (int rotation = 1; rotation < Tile::ROTATIONS; rotation++)
+        {
+            edges = ((edges << 3) | (edges >> (3 * (Tile::ROTATIONS - 1)))) & 0777777;
+            smallest = std::min(smallest, edges);
+        }
+        return smallest;
+    }
+
+    std::uint64_t getCellKey(CellId id)
+    {
+        const auto [q, r] = Board::toAxial(id);
+        return (static_cast<std::uint64_t>(static_cast<std::uint32_t>(q)) & 0xffff) << 16 |
+               (static_cast<std::uint64_t>(static_cast<std::uint32_t>(r)) & 0xffff);
+    }
+}
+
+std::uint64_t OpeningBook::getPositionKey(const Game &game)
+{
+    const Tile *drawn = game.getDrawnTile();
+    if (!drawn)
+    {
+        throw std::runtime_error("a position in the book needs a drawn tile");
+    }
+    const Board &board = game.getBoard();
+    const int symmetry = board.getCanonicalSymmetry();
+    const std::uint32_t drawnEdges = getRotationFreeEdges(packEdges(Board::transformEdges(PlacedTile{*drawn, CellId{0, 0}, 0}, symmetry)));
+    const std::uint64_t drawnTask = drawn->isTask() ? static_cast<std::uint64_t>(drawn->getTask()) : NO_TASK;
+    std::uint64_t key = splitmix64(board.getCanonicalHash() ^ splitmix64(drawnEdges | drawnTask << 18 | static_cast<std::uint64_t>(game.getDrawnTaskSize().value_or(0)) << 21));
+    // XOR keeps the key independent of the order of the tasks.
+    std::uint64_t tasks = 0;
+    for (const Task &task : game.getCurrentTasks())
+    {
+        tasks ^= splitmix64(getCellKey(Board::transformCell(task.position, symmetry)) << 32 |
+                            static_cast<std::uint64_t>(task.size) << 8 | static_cast<std::uint64_t>(task.terrain));
+    }
+    return splitmix64(key ^ tasks);
+}
+
+BookEntry OpeningBook::makeEntry(const Game &game, const Move &move, std::uint32_t visits, float meanScore)
+{
+    const int symmetry = game.getBoard().getCanonicalSymmetry();
+    const CellId cell = Board::transformCell(move.position, symmetry);
+    const std::uint32_t edges = packEdges(Board::transformEdges(PlacedTile{*move.tile, move.position, move.rotation}, symmetry));
+    return BookEntry{getPositionKey(game), static_cast<std::int16_t>(cell.x), static_cast<std::int16_t>(cell.y), edges, visits, meanScore};
+}
+
+std::optional<Move> OpeningBook::findMove(const Game &game, const BookEntry &entry)
+{
+    const int symmetry = game.getBoard().getCanonicalSymmetry();
+    for (const Move &move : game.generateMoves())
+    {
+        if (Board::transformCell(move.position, symmetry) == CellId{entry.x, entry.y} &&
+            packEdges(Board::transformEdges(PlacedTile{*move.tile, move.position, move.rotation}, symmetry)) == entry.edges)
+        {
+            return move;
+        }
+    }
+    return std::nullopt;
+}
+
+void OpeningBook::save(const std::string &path, std::vector<BookEntry> entries)
+{
+    std::sort(entries.begin(), entries.end(), [](const BookEntry &lhs, const BookEntry &rhs)
+              { return lhs.key != rhs.key ? lhs.key < rhs.key : lhs.visits > rhs.visits; });
+    entries.erase(std::unique(entries.begin(), entries.end(), [](const BookEntry &lhs, const BookEntry &rhs)
+                              { return lhs.key == rhs.key; }),
+                  entries.end());
+
+    BookHeader header;
+    std::memcpy(header.magic, BOOK_MAGIC, sizeof(BOOK_MAGIC));
+    header.version = BOOK_VERSION;
+    header.entrySize = sizeof(BookEntry);
+    header.entriesCount = entries.size();
+    header.byteOrderMark = BYTE_ORDER_MARK;
+
+    writeFileAtomically(path, {{&header, sizeof(header)}, {entries.data(), entries.size() * sizeof(BookEntry)}}, "opening book");
+}
+
+auto OpeningBook::map(const std::string &path) -> std::shared_ptr<const OpeningBook>
+{
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        throw std::runtime_error("cannot open opening book: " + path);
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) < sizeof(BookHeader))
+    {
+        close(fd);
+        throw std::runtime_error("opening book is too short: " + path);
+    }
+    const std::size_t size = st.st_size;
+    void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        throw std::runtime_error("cannot map opening book: " + path);
+    }
+    std::shared_ptr<OpeningBook> book(new OpeningBook());
+    book->m_mapping = mapping;
+    book->m_mappingSize = size;
+    BookHeader header;
+    std::memcpy(&header, mapping, sizeof(header));
+    if (std::memcmp(header.magic, BOOK_MAGIC, sizeof(BOOK_MAGIC)) != 0 || header.version != BOOK_VERSION ||
+        header.entrySize != sizeof(BookEntry) || header.byteOrderMark != BYTE_ORDER_MARK ||
+        size != sizeof(BookHeader) + header.entriesCount * sizeof(BookEntry))
+    {
+        throw std::runtime_error("not an opening book of this version: " + path);
+    }
+    book->m_entries = reinterpret_cast<const BookEntry *>(static_cast<const char *>(mapping) + sizeof(BookHeader));
+    book->m_entriesCount = header.entriesCount;
+    return book;
+}
+
+OpeningBook::~OpeningBook()
+{
+    if (m_mapping)
+    {
+        munmap(m_mapping, m_mappingSize);
+    }
+}
+
+auto OpeningBook::find(std::uint64_t key) const -> const BookEntry *
+{
+    const BookEntry *end = m_entries + m_entriesCount;
+    const BookEntry *it = std::lower_bound(m_entries, end, key, [](const BookEntry &entry, std::uint64_t k)
+                                           { return entry.key < k; });
+    return it != end && it->key == key ? it : nullptr;
+}
+
+std::optional<Move> OpeningBook::lookup(const Game &game) const
+{
+    const BookEntry *entry = find(getPositionKey(game));
+    return entry ? findMove(game, *entry) : std::nullopt;
+}
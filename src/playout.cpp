@@ -0,0 +1,543 @@
+#include "playout.h"
+
+#include <algorithm>
+#include <cassert>
+#include <sstream>
+#include <stdexcept>
+
+namespace
+{
+    constexpr std::uint32_t KEY_BIAS = 0x8000;
+    constexpr std::uint32_t EDGES_MASK = 0x3ffff;
+
+    // Same deltas as Board::getPotentialNeighbors, indexed by column parity.
+    constexpr int NEIGHBOR_DELTAS[2][Tile::ROTATIONS][2] = {
+        {{-1, -1}, {0, -1}, {1, -1}, {1, 0}, {0, 1}, {-1, 0}},
+        {{-1, 0}, {0, -1}, {1, 0}, {1, 1}, {0, 1}, {-1, 1}},
+    };
+
+    // Bit 8 * edge + side is set if a tile edge may touch the side constraint of a frontier cell.
+    std::uint64_t buildCompatibleSides()
+    {
+        std::uint64_t compatible = 0;
+        for (int edge = 0; edge < CompatibilityMatrix::TERRAINS; edge++)
+        {
+            for (std::uint32_t side = 0; side <= Board::FREE_SIDE; side++)
+            {
+                if (side == Board::FREE_SIDE || areTerrainsCompatible(static_cast<Terrain>(edge), static_cast<Terrain>(side)))
+                {
+                    compatible |= std::uint64_t{1} << (8 * edge + side);
+                }
+            }
+        }
+        return compatible;
+    }
+
+    const std::uint64_t COMPATIBLE_SIDES = buildCompatibleSides();
+
+    // Multiply-shift instead of std::uniform_int_distribution; the bias is negligible for rollouts.
+    std::uint32_t uniform(std::mt19937 &rng, std::uint32_t bound)
+    {
+        return (std::uint64_t{rng()} * bound) >> 32;
+    }
+
+    std::uint32_t getSideAt(std::uint32_t packed, int direction)
+    {
+        return (packed >> (3 * direction)) & Board::FREE_SIDE;
+    }
+}
+
+Playout Playout::fromGame(const Game &game)
+{
+    Playout playout;
+    for (int i = game.getNextLandIndex(); i < static_cast<int>(game.getLands().size()); i++)
+    {
+        playout.m_lands.push_back(PackedTile{pack(game.getLands()[i]), -1});
+    }
+    for (int i = game.getNextTaskIndex(); i < static_cast<int>(game.getTasks().size()); i++)
+    {
+        const Tile &tile = game.getTasks()[i];
+        playout.m_taskTiles.push_back(PackedTile{pack(tile), static_cast<int>(tile.getTask())});
+    }
+    for (const auto &[terrain, size] : game.getFreeTaskSizes())
+    {
+        playout.m_freeTaskSizes[static_cast<int>(terrain)].push_back(size);
+    }
+
+    const Board &board = game.getBoard();
+    const auto tiles = board.getTiles();
+    playout.reserveSlots(tiles.size() + board.getFrontierSize() + Tile::ROTATIONS + 1);
+    for (const auto &[id, placed] : tiles)
+    {
+        Slot &slot = playout.insert(toKey(id));
+        slot.edges = rotate(pack(placed.tile), placed.rotation);
+        slot.frontierIndex = OCCUPIED;
+    }
+    for (const auto &[signature, cells] : board.getFrontierGroups())
+    {
+        for (CellId cell : cells)
+        {
+            Slot &slot = playout.insert(toKey(cell));
+            slot.edges = signature;
+            slot.frontierIndex = playout.m_frontier.size();
+            playout.m_frontier.push_back(slot.key);
+        }
+    }
+    playout.m_placedTilesCount = tiles.size();
+
+    for (const Task &task : game.getCurrentTasks())
+    {
+        PlayoutTask playoutTask{task.size, static_cast<int>(task.terrain), {}, {}};
+        playout.expandTask(playoutTask, toKey(task.position), EMPTY_KEY, 0);
+        playout.m_tasks.push_back(std::move(playoutTask));
+    }
+    playout.m_finishedTasksCount = game.getFinishedTasks().size();
+    if (const Tile *drawn = game.getDrawnTile())
+    {
+        playout.m_drawn = PackedTile{pack(*drawn), drawn->isTask() ? static_cast<int>(drawn->getTask()) : -1};
+        playout.m_drawnTaskSize = game.getDrawnTaskSize().value_or(0);
+    }
+    return playout;
+}
+
+void Playout::shuffleRemainingTiles(std::mt19937 &rng)
+{
+    std::shuffle(m_lands.begin() + m_nextLand, m_lands.end(), rng);
+    std::shuffle(m_taskTiles.begin() + m_nextTaskTile, m_taskTiles.end(), rng);
+}
+
+bool Playout::drawNextTile(std::mt19937 &rng, std::optional<int> taskSize)
+{
+    m_drawn.reset();
+    if (static_cast<int>(m_tasks.size()) < Game::MAX_CONCURRENT_TASKS && m_nextTaskTile < static_cast<int>(m_taskTiles.size()))
+    {
+        m_drawn = m_taskTiles[m_nextTaskTile++];
+        m_drawnTaskSize = fetchTaskSize(m_drawn->task, rng, taskSize);
+        return true;
+    }
+    if (m_nextLand < static_cast<int>(m_lands.size()) - Game::UNUSED_LANDS)
+    {
+        m_drawn = m_lands[m_nextLand++];
+        return true;
+    }
+    return false; // No tiles left
+}
+
+bool Playout::isLegal(CellId position, int rotation) const
+{
+    if (!m_drawn)
+    {
+        return false;
+    }
+    const std::uint32_t key = toKey(position);
+    if (m_placedTilesCount == 0)
+    {
+        return position == CellId{0, 0} && isLegalAt(key, Board::FREE_SIGNATURE, rotation);
+    }
+    const Slot *slot = find(key);
+    if (!slot || slot->frontierIndex == OCCUPIED)
+    {
+        return false;
+    }
+    return isLegalAt(key, slot->edges, rotation);
+}
+
+void Playout::place(CellId position, int rotation)
+{
+    assert(isLegal(position, rotation));
+    placeAt(toKey(position), rotation);
+}
+
+bool Playout::playRandomMove(std::mt19937 &rng)
+{
+    if (!m_drawn)
+    {
+        return false;
+    }
+    // Sampling (cell, rotation) pairs and rejecting illegal ones picks every legal move with the same probability
+    // as choosing from the full list, without building it. The list is built only when legal moves are rare.
+    if (m_placedTilesCount > 0)
+    {
+        for (int attempt = 0; attempt < MAX_REJECTION_ATTEMPTS; attempt++)
+        {
+            const std::uint32_t key = m_frontier[uniform(rng, m_frontier.size())];
+            const int rotation = uniform(rng, Tile::ROTATIONS);
+            if (isLegalAt(key, find(key)->edges, rotation))
+            {
+                placeAt(key, rotation);
+                return true;
+            }
+        }
+    }
+    countLegalMoves(); // fills m_scratchMoves
+    if (m_scratchMoves.empty())
+    {
+        return false;
+    }
+    const auto [key, rotation] = m_scratchMoves[uniform(rng, m_scratchMoves.size())];
+    placeAt(key, rotation);
+    return true;
+}
+
+int Playout::playToEnd(std::mt19937 &rng)
+{
+    while (drawNextTile(rng) && playRandomMove(rng))
+    {
+    }
+    return m_finishedTasksCount;
+}
+
+int Playout::getFrontierIndex(CellId cell) const
+{
+    const Slot *slot = find(toKey(cell));
+    return slot ? slot->frontierIndex : -1;
+}
+
+bool Playout::isLegalAtFrontier(int index, int rotation) const
+{
+    const std::uint32_t key = m_frontier.at(index);
+    return m_drawn && isLegalAt(key, find(key)->edges, rotation);
+}
+
+void Playout::placeAtFrontier(int index, int rotation)
+{
+    assert(isLegalAtFrontier(index, rotation));
+    placeAt(m_frontier.at(index), rotation);
+}
+
+int Playout::countLegalMoves() const
+{
+    m_scratchMoves.clear();
+    if (!m_drawn)
+    {
+        return 0;
+    }
+    for (int rotation = 0; rotation < Tile::ROTATIONS; rotation++)
+    {
+        if (m_placedTilesCount == 0)
+        {
+            const std::uint32_t key = toKey(CellId{0, 0});
+            if (isLegalAt(key, Board::FREE_SIGNATURE, rotation))
+            {
+                m_scratchMoves.emplace_back(key, rotation);
+            }
+            continue;
+        }
+        for (std::uint32_t key : m_frontier)
+        {
+            if (isLegalAt(key, find(key)->edges, rotation))
+            {
+                m_scratchMoves.emplace_back(key, rotation);
+            }
+        }
+    }
+    return m_scratchMoves.size();
+}
+
+std::uint32_t Playout::toKey(CellId id)
+{
+    return ((static_cast<std::uint32_t>(id.x) + KEY_BIAS) & 0xffff) << 16 | ((static_cast<std::uint32_t>(id.y) + KEY_BIAS) & 0xffff);
+}
+
+CellId Playout::fromKey(std::uint32_t key)
+{
+    return CellId{static_cast<int>(key >> 16) - static_cast<int>(KEY_BIAS), static_cast<int>(key & 0xffff) - static_cast<int>(KEY_BIAS)};
+}
+
+std::uint32_t Playout::getNeighborKey(std::uint32_t key, int direction)
+{
+    // KEY_BIAS is even, so the parity of the biased x is the parity of x.
+    const int *delta = NEIGHBOR_DELTAS[(key >> 16) & 1][direction];
+    return key + static_cast<std::uint32_t>(delta[0] * 0x10000 + delta[1]);
+}
+
+Playout::PackedEdges Playout::pack(const Tile &tile)
+{
+    PackedEdges edges = 0;
+    for (int i = 0; i < Tile::ROTATIONS; i++)
+    {
+        edges |= static_cast<PackedEdges>(tile.getEdgeAt(i)) << (3 * i);
+    }
+    return edges;
+}
+
+Playout::PackedEdges Playout::rotate(PackedEdges edges, int rotation)
+{
+    // The edge i of the tile points to the absolute direction i + rotation.
+    if (rotation == 0)
+    {
+        return edges;
+    }
+    return ((edges << (3 * rotation)) | (edges >> (3 * (Tile::ROTATIONS - rotation)))) & EDGES_MASK;
+}
+
+bool Playout::fits(PackedEdges absoluteEdges, ConstraintSignature signature)
+{
+    for (int direction = 0; direction < Tile::ROTATIONS; direction++)
+    {
+        const std::uint32_t bit = 8 * getSideAt(absoluteEdges, direction) + getSideAt(signature, direction);
+        if (!((COMPATIBLE_SIDES >> bit) & 1))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+auto Playout::find(std::uint32_t key) const -> const Slot *
+{
+    if (m_slots.empty())
+    {
+        return nullptr;
+    }
+    const std::size_t mask = m_slots.size() - 1;
+    for (std::size_t i = (key * 0x9e3779b1u) >> m_shift;; i = (i + 1) & mask)
+    {
+        if (m_slots[i].key == key)
+        {
+            return &m_slots[i];
+        }
+        if (m_slots[i].key == EMPTY_KEY)
+        {
+            return nullptr;
+        }
+    }
+}
+
+auto Playout::find(std::uint32_t key) -> Slot *
+{
+    return const_cast<Slot *>(static_cast<const Playout *>(this)->find(key));
+}
+
+auto Playout::insert(std::uint32_t key) -> Slot &
+{
+    // The caller reserves the slots, so that references to other slots stay valid.
+    assert(2 * (m_usedSlots + 1) <= static_cast<int>(m_slots.size()));
+    const std::size_t mask = m_slots.size() - 1;
+    std::size_t i = (key * 0x9e3779b1u) >> m_shift;
+    while (m_slots[i].key != EMPTY_KEY)
+    {
+        i = (i + 1) & mask;
+    }
+    m_usedSlots++;
+    m_slots[i].key = key;
+    return m_slots[i];
+}
+
+void Playout::reserveSlots(int slots)
+{
+    const int needed = 2 * (m_usedSlots + slots);
+    if (needed <= static_cast<int>(m_slots.size()))
+    {
+        return;
+    }
+    int capacity = 64;
+    int bits = 6;
+    while (capacity < needed)
+    {
+        capacity *= 2;
+        bits++;
+    }
+    std::vector<Slot> oldSlots(capacity, Slot{EMPTY_KEY, 0, 0});
+    oldSlots.swap(m_slots);
+    m_shift = 32 - bits;
+    m_usedSlots = 0;
+    for (const Slot &slot : oldSlots)
+    {
+        if (slot.key != EMPTY_KEY)
+        {
+            insert(slot.key) = slot;
+        }
+    }
+}
+
+void Playout::removeFromFrontier(Slot &slot)
+{
+    const int index = slot.frontierIndex;
+    const std::uint32_t last = m_frontier.back();
+    m_frontier[index] = last;
+    find(last)->frontierIndex = index;
+    m_frontier.pop_back();
+    slot.frontierIndex = OCCUPIED;
+}
+
+auto Playout::getEdges(std::uint32_t key, std::uint32_t extraKey, PackedEdges extraEdges) const -> std::optional<PackedEdges>
+{
+    if (key == extraKey)
+    {
+        return extraEdges;
+    }
+    const Slot *slot = find(key);
+    if (slot && slot->frontierIndex == OCCUPIED)
+    {
+        return slot->edges;
+    }
+    return std::nullopt;
+}
+
+bool Playout::isLegalAt(std::uint32_t key, ConstraintSignature signature, int rotation) const
+{
+    const PackedEdges edges = rotate(m_drawn->edges, rotation);
+    if (!fits(edges, signature))
+    {
+        return false;
+    }
+    if (m_drawn->task < 0)
+    {
+        // A land can close even an unfinished task.
+        return true;
+    }
+    return keepsTasksPossible(key, edges);
+}
+
+bool Playout::keepsTasksPossible(std::uint32_t key, PackedEdges absoluteEdges) const
+{
+    for (const PlayoutTask &task : m_tasks)
+    {
+        m_scratchTask = task;
+        advanceTask(m_scratchTask, key, absoluteEdges);
+        if (getStatus(m_scratchTask) == TaskStatus::Failed)
+        {
+            return false;
+        }
+    }
+    m_scratchTask.size = m_drawnTaskSize;
+    m_scratchTask.terrain = m_drawn->task;
+    m_scratchTask.region.clear();
+    m_scratchTask.pending.clear();
+    expandTask(m_scratchTask, key, key, absoluteEdges);
+    return getStatus(m_scratchTask) != TaskStatus::Failed;
+}
+
+void Playout::placeAt(std::uint32_t key, int rotation)
+{
+    assert(m_drawn);
+    reserveSlots(Tile::ROTATIONS + 1);
+    const PackedEdges edges = rotate(m_drawn->edges, rotation);
+    Slot *slot = find(key);
+    if (slot)
+    {
+        removeFromFrontier(*slot);
+    }
+    else
+    {
+        slot = &insert(key);
+        slot->frontierIndex = OCCUPIED;
+    }
+    slot->edges = edges;
+    for (int direction = 0; direction < Tile::ROTATIONS; direction++)
+    {
+        const std::uint32_t neighborKey = getNeighborKey(key, direction);
+        Slot *neighbor = find(neighborKey);
+        if (!neighbor)
+        {
+            neighbor = &insert(neighborKey);
+            neighbor->edges = Board::FREE_SIGNATURE;
+            neighbor->frontierIndex = m_frontier.size();
+            m_frontier.push_back(neighborKey);
+        }
+        else if (neighbor->frontierIndex == OCCUPIED)
+        {
+            continue;
+        }
+        const int opposite = (direction + Tile::ROTATIONS / 2) % Tile::ROTATIONS;
+        neighbor->edges = Board::withSide(neighbor->edges, opposite, getSideAt(edges, direction));
+    }
+    m_placedTilesCount++;
+
+    for (auto it = m_tasks.begin(); it != m_tasks.end();)
+    {
+        advanceTask(*it, key, edges);
+        const TaskStatus status = getStatus(*it);
+        m_finishedTasksCount += status == TaskStatus::Finished;
+        it = status == TaskStatus::Open ? it + 1 : m_tasks.erase(it);
+    }
+    if (m_drawn->task >= 0)
+    {
+        PlayoutTask task{m_drawnTaskSize, m_drawn->task, {}, {}};
+        expandTask(task, key, key, edges);
+        const TaskStatus status = getStatus(task);
+        m_finishedTasksCount += status == TaskStatus::Finished;
+        if (status == TaskStatus::Open)
+        {
+            m_tasks.push_back(std::move(task));
+        }
+    }
+    m_drawn.reset();
+}
+
+int Playout::fetchTaskSize(int terrain, std::mt19937 &rng, std::optional<int> taskSize)
+{
+    std::vector<int> &sizes = m_freeTaskSizes[terrain];
+    if (sizes.empty())
+    {
+        std::ostringstream oss;
+        oss << "No " << static_cast<Terrain>(terrain) << " tasks left, but one was required.";
+        throw std::runtime_error(oss.str());
+    }
+    std::size_t index = taskSize ? std::find(sizes.begin(), sizes.end(), *taskSize) - sizes.begin() : uniform(rng, sizes.size());
+    if (index == sizes.size())
+    {
+        std::ostringstream oss;
+        oss << "No " << static_cast<Terrain>(terrain) << " task of size " << *taskSize << " left.";
+        throw std::runtime_error(oss.str());
+    }
+    const int size = sizes[index];
+    sizes[index] = sizes.back();
+    sizes.pop_back();
+    return size;
+}
+
+void Playout::expandTask(PlayoutTask &task, std::uint32_t from, std::uint32_t extraKey, PackedEdges extraEdges) const
+{
+    // The region doubles as the BFS queue: cells after `next` have not been searched yet.
+    // A region larger than the task makes it fail anyway, so the search stops there.
+    std::size_t next = task.region.size();
+    task.region.push_back(from);
+    while (next < task.region.size() && static_cast<int>(task.region.size()) <= task.size)
+    {
+        const std::uint32_t key = task.region[next++];
+        const PackedEdges edges = *getEdges(key, extraKey, extraEdges);
+        for (int direction = 0; direction < Tile::ROTATIONS; direction++)
+        {
+            if (static_cast<int>(getSideAt(edges, direction)) != task.terrain)
+            {
+                continue;
+            }
+            const std::uint32_t neighborKey = getNeighborKey(key, direction);
+            if (!getEdges(neighborKey, extraKey, extraEdges))
+            {
+                task.pending.push_back(neighborKey);
+            }
+            else if (std::find(task.region.begin(), task.region.end(), neighborKey) == task.region.end())
+            {
+                task.region.push_back(neighborKey);
+            }
+        }
+    }
+}
+
+void Playout::advanceTask(PlayoutTask &task, std::uint32_t placedKey, PackedEdges placedEdges) const
+{
+    auto pendingEnd = std::remove(task.pending.begin(), task.pending.end(), placedKey);
+    if (pendingEnd == task.pending.end())
+    {
+        return; // the region does not lead to the placed tile
+    }
+    task.pending.erase(pendingEnd, task.pending.end());
+    expandTask(task, placedKey, placedKey, placedEdges);
+}
+
+auto Playout::getStatus(const PlayoutTask &task) -> TaskStatus
+{
+    const int size = task.region.size();
+    if (size == task.size)
+    {
+        return TaskStatus::Finished;
+    }
+    if (task.pending.empty() || size > task.size)
+    {
+        return TaskStatus::Failed;
+    }
+    return TaskStatus::Open;
+}
@@ -0,0 +1,54 @@
+#include "rollout_search.h"
+
+#include <algorithm>
+#include <random>
+
+#include "playout.h"
+
+std::vector<MoveStatistics> searchMoves(const Game &game, const SearchOptions &options)
+{
+    const Playout initial = Playout::fromGame(game);
+    std::mt19937 rng(options.seed);
+    std::vector<MoveStatistics> statistics;
+    for (const Move &move : game.generateMoves())
+    {
+        long long score = 0;
+        for (int rollout = 0; rollout < options.rolloutsPerMove; rollout++)
+        {
+            Playout playout = initial;
+            playout.shuffleRemainingTiles(rng);
+            playout.place(move.position, move.rotation);
+            score += playout.playToEnd(rng);
+        }
+        const double meanScore = options.rolloutsPerMove > 0 ? static_cast<double>(score) / options.rolloutsPerMove : 0;
+        statistics.push_back(MoveStatistics{move, options.rolloutsPerMove, meanScore});
+    }
+    std::stable_sort(statistics.begin(), statistics.end(), [](const MoveStatistics &lhs, const MoveStatistics &rhs)
+                     { return lhs.meanScore > rhs.meanScore; });
+    return statistics;
+}
+
+std::optional<Move> chooseMove(const Game &game, const OpeningBook *book, const SearchOptions &options, bool *fromBook)
+{
+    if (fromBook)
+    {
+        *fromBook = false;
+    }
+    if (book)
+    {
+        if (std::optional<Move> move = book->lookup(game))
+        {
+            if (fromBook)
+            {
+                *fromBook = true;
+            }
+            return move;
+        }
+    }
+    std::vector<MoveStatistics> statistics = searchMoves(game, options);
+    if (statistics.empty())
+    {
+        return std::nullopt;
+    }
+    return statistics.front().move;
+}
@@ -0,0 +1,190 @@
+#include "self_play.h"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+
+#include "random.h"
+#include "rollout_search.h"
+
+namespace
+{
+    // Tilesets of the generator can have more tiles than an int16 holds, so counts saturate instead of wrapping.
+    template <class T>
+    T saturate(long long value)
+    {
+        return static_cast<T>(std::clamp<long long>(value, std::numeric_limits<T>::min(), std::numeric_limits<T>::max()));
+    }
+
+    std::uint8_t terrainFeature(Terrain terrain)
+    {
+        return static_cast<std::uint8_t>(static_cast<int>(terrain) + 1);
+    }
+
+    void putPlacedTile(const PlacedTile &placed, int cellIndex, TrainingSample &sample)
+    {
+        const int planeSize = FEATURE_WINDOW_SIDE * FEATURE_WINDOW_SIDE;
+        for (int direction = 0; direction < Tile::ROTATIONS; direction++)
+        {
+            sample.planes[direction * planeSize + cellIndex] = terrainFeature(placed.getEdgeTowards(direction));
+        }
+        if (placed.tile.isTask())
+        {
+            sample.planes[Tile::ROTATIONS * planeSize + cellIndex] = terrainFeature(placed.tile.getTask());
+        }
+    }
+
+    auto pickCandidates(int movesCount, int chosen, int maxCandidates) -> std::vector<int>
+    {
+        std::vector<int> candidates(movesCount);
+        std::iota(candidates.begin(), candidates.end(), 0);
+        if (maxCandidates <= 0 || movesCount <= maxCandidates)
+        {
+            return candidates;
+        }
+        candidates.erase(candidates.begin() + chosen);
+        std::shuffle(candidates.begin(), candidates.end(), getRandomEngine());
+        candidates.resize(maxCandidates - 1);
+        candidates.push_back(chosen);
+        std::sort(candidates.begin(), candidates.end());
+        return candidates;
+    }
+
+    // Index of the move to play: chooseMove's when searching, the book move while the game is in the book,
+    // otherwise a random one.
+    int pickMove(const Game &game, const std::vector<Move> &moves, const SelfPlayOptions &options)
+    {
+        std::optional<Move> picked;
+        if (options.rolloutsPerMove > 0)
+        {
+            const SearchOptions search{options.rolloutsPerMove, getRandom(std::uniform_int_distribution<unsigned>())};
+            picked = chooseMove(game, options.book, search);
+        }
+        else if (options.book)
+        {
+            picked = options.book->lookup(game);
+        }
+        if (picked)
+        {
+            auto it = std::find_if(moves.begin(), moves.end(), [&picked](const Move &move)
+                                   { return move.position == picked->position && move.rotation == picked->rotation; });
+            if (it != moves.end())
+            {
+                return std::distance(moves.begin(), it);
+            }
+        }
+        return getRandom(std::uniform_int_distribution<int>(0, moves.size() - 1));
+    }
+}
+
+void extractMoveFeatures(const Game &game, const Move &move, TrainingSample &sample)
+{
+    sample.planes.fill(0);
+    sample.taskState.fill(0);
+
+    const Board &board = game.getBoard();
+    const auto [centerQ, centerR] = Board::toAxial(move.position);
+    for (int dq = -FEATURE_WINDOW_RADIUS; dq <= FEATURE_WINDOW_RADIUS; dq++)
+    {
+        for (int dr = -FEATURE_WINDOW_RADIUS; dr <= FEATURE_WINDOW_RADIUS; dr++)
+        {
+            const int cellIndex = (dq + FEATURE_WINDOW_RADIUS) * FEATURE_WINDOW_SIDE + (dr + FEATURE_WINDOW_RADIUS);
+            const CellId cell = Board::fromAxial(centerQ + dq, centerR + dr);
+            if (cell == move.position)
+            {
+                putPlacedTile(PlacedTile{*move.tile, cell, move.rotation}, cellIndex, sample);
+            }
+            else if (board.hasTileAt(cell))
+            {
+                putPlacedTile(board.getTileAt(cell), cellIndex, sample);
+            }
+        }
+    }
+
+    const std::vector<Task> &tasks = game.getCurrentTasks();
+    for (int i = 0; i < std::min<int>(tasks.size(), Game::MAX_CONCURRENT_TASKS); i++)
+    {
+        const auto [taskQ, taskR] = Board::toAxial(tasks[i].position);
+        sample.taskState[i * TASK_STATE_FIELDS + 0] = terrainFeature(tasks[i].terrain);
+        sample.taskState[i * TASK_STATE_FIELDS + 1] = saturate<std::int16_t>(tasks[i].size);
+        sample.taskState[i * TASK_STATE_FIELDS + 2] = saturate<std::int16_t>(taskQ - centerQ);
+        sample.taskState[i * TASK_STATE_FIELDS + 3] = saturate<std::int16_t>(taskR - centerR);
+    }
+    const int tail = Game::MAX_CONCURRENT_TASKS * TASK_STATE_FIELDS;
+    sample.taskState[tail + 0] = move.tile->isTask() ? terrainFeature(move.tile->getTask()) : 0;
+    sample.taskState[tail + 1] = saturate<std::int16_t>(move.taskSize.value_or(0));
+    sample.taskState[tail + 2] = saturate<std::int16_t>(game.getRemainingTilesCount());
+    sample.taskState[tail + 3] = saturate<std::int16_t>(game.getFinishedTasks().size());
+}
+
+int playSelfPlayGame(Game &game, std::uint32_t gameId, TrainingDataWriter &writer, const SelfPlayOptions &options)
+{
+    // The outcome is known only at the end, so the samples of one game wait in memory.
+    std::vector<TrainingSample> samples;
+    int turn = 0;
+    while (true)
+    {
+        std::vector<Move> moves = game.nextMoves();
+        if (moves.empty())
+        {
+            break;
+        }
+        const int chosen = pickMove(game, moves, options);
+        for (int index : pickCandidates(moves.size(), chosen, options.maxCandidatesPerTurn))
+        {
+            TrainingSample sample;
+            sample.gameId = gameId;
+            sample.turn = saturate<std::uint16_t>(turn);
+            sample.chosen = index == chosen ? 1 : 0;
+            extractMoveFeatures(game, moves[index], sample);
+            samples.push_back(sample);
+        }
+        game.makeMove(moves[chosen]);
+        turn++;
+    }
+    const int outcome = game.getFinishedTasks().size();
+    for (TrainingSample &sample : samples)
+    {
+        sample.outcome = saturate<std::int16_t>(outcome);
+        writer.append(sample);
+    }
+    return outcome;
+}
+
+ReplayRecord playRecordedGame(const YAML::Node &rootNode, std::uint32_t seed, std::shared_ptr<const CompatibilityMatrix> compatibility)
+{
+    setSeed(seed);
+    Game game = Game::fromYaml(rootNode, std::move(compatibility));
+    std::mt19937 moveEngine(seed);
+    ReplayRecord record;
+    record.seed = seed;
+    for (std::vector<Move> moves = game.nextMoves(); !moves.empty(); moves = game.nextMoves())
+    {
+        const Move &move = moves[std::uniform_int_distribution<int>(0, moves.size() - 1)(moveEngine)];
+        record.moves.push_back(ReplayMove{static_cast<std::int16_t>(move.position.x), static_cast<std::int16_t>(move.position.y),
+                                          static_cast<std::uint8_t>(move.rotation), static_cast<std::uint8_t>(move.taskSize.value_or(0))});
+        game.makeMove(move);
+    }
+    record.finishedTasks = game.getFinishedTasks().size();
+    return record;
+}
+
+int replayGame(const YAML::Node &rootNode, const ReplayRecord &record, std::shared_ptr<const CompatibilityMatrix> compatibility)
+{
+    setSeed(record.seed);
+    Game game = Game::fromYaml(rootNode, std::move(compatibility));
+    for (const ReplayMove &replayMove : record.moves)
+    {
+        const std::vector<Move> moves = game.nextMoves();
+        auto it = std::find_if(moves.begin(), moves.end(), [&replayMove](const Move &move)
+                               { return move.position == CellId{replayMove.x, replayMove.y} && move.rotation == replayMove.rotation &&
+                                        move.taskSize.value_or(0) == replayMove.taskSize; });
+        if (it == moves.end())
+        {
+            throw std::runtime_error("replayed move is not legal in the game of seed " + std::to_string(record.seed));
+        }
+        game.makeMove(*it);
+    }
+    return game.getFinishedTasks().size();
+}
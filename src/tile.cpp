@@ -79,7 +79,7 @@ Tile::Tile(std::string_view edgeChars)
 Tile::Tile(const std::array<Terrain, ROTATIONS> &edges, Terrain task)
     : m_edges(edges), m_task(task) {}
 
-Tile::Tile(const Tile &other) : m_edges(other.m_edges), m_task(other.m_task)
+Tile::Tile(const Tile &other) : m_edges(other.m_edges), m_task(other.m_task), m_catalogIndex(other.m_catalogIndex)
 {
 }
 
@@ -0,0 +1,31 @@
+#include "tile_catalog.h"
+
+namespace
+{
+    constexpr int BITS_PER_TERRAIN = 3;
+    constexpr std::uint32_t NO_TASK = 7;
+}
+
+std::uint32_t TileCatalog::getKey(const Tile &tile)
+{
+    std::uint32_t key = tile.isTask() ? static_cast<std::uint32_t>(tile.getTask()) : NO_TASK;
+    for (int i = 0; i < Tile::ROTATIONS; i++)
+    {
+        key = key << BITS_PER_TERRAIN | static_cast<std::uint32_t>(tile.getEdgeAt(i));
+    }
+    return key;
+}
+
+int TileCatalog::intern(const Tile &tile)
+{
+    auto [it, inserted] = m_typeByKey.emplace(getKey(tile), m_types.size());
+    if (inserted)
+    {
+        m_types.push_back(tile);
+        m_types.back().setCatalogIndex(it->second);
+        m_counts.push_back(0);
+    }
+    m_counts[it->second]++;
+    m_tilesCount++;
+    return it->second;
+}
@@ -0,0 +1,132 @@
+#include "tileset_generator.h"
+
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+#include "tile.h"
+
+namespace
+{
+    // Indexed by Terrain, the same characters as in tiles.yaml.
+    const char TERRAIN_CHARS[] = {'_', 'P', 'F', 'T', 'R', 'W'};
+    constexpr double SINGLE_EDGE_LINE_PROBABILITY = 0.2; // a rail or river which ends on the tile
+    constexpr int MIN_TASK_SIZE = 4;
+    constexpr int MAX_TASK_SIZE = 6;
+
+    void validate(const TilesetOptions &options)
+    {
+        if (options.tiles <= 0)
+        {
+            throw std::runtime_error("a tileset needs at least one tile");
+        }
+        for (double probability : {options.taskTileShare, options.railDensity, options.riverDensity})
+        {
+            if (probability < 0 || probability > 1)
+            {
+                throw std::runtime_error("tile shares and densities must be between 0 and 1");
+            }
+        }
+        double weightsSum = 0;
+        for (double weight : options.terrainWeights)
+        {
+            if (weight < 0)
+            {
+                throw std::runtime_error("terrain weights cannot be negative");
+            }
+            weightsSum += weight;
+        }
+        if (weightsSum <= 0)
+        {
+            throw std::runtime_error("at least one terrain weight must be positive");
+        }
+        const double taskTerrainsWeight = weightsSum - options.terrainWeights[static_cast<int>(Terrain::Grass)];
+        if (options.taskTileShare > 0 && taskTerrainsWeight <= 0 && options.railDensity <= 0 && options.riverDensity <= 0)
+        {
+            throw std::runtime_error("task tiles need edges of some terrain other than Grass");
+        }
+    }
+
+    std::string generateEdges(const TilesetOptions &options, std::mt19937 &rng)
+    {
+        std::string edges(Tile::ROTATIONS, ' ');
+        auto placeLine = [&edges, &rng](Terrain terrain)
+        {
+            const int length = std::bernoulli_distribution(SINGLE_EDGE_LINE_PROBABILITY)(rng) ? 1 : 2;
+            for (int placed = 0; placed < length;)
+            {
+                const int edge = std::uniform_int_distribution<int>(0, Tile::ROTATIONS - 1)(rng);
+                if (edges[edge] == ' ')
+                {
+                    edges[edge] = TERRAIN_CHARS[static_cast<int>(terrain)];
+                    placed++;
+                }
+            }
+        };
+        if (std::bernoulli_distribution(options.railDensity)(rng))
+        {
+            placeLine(Terrain::Rail);
+        }
+        if (std::bernoulli_distribution(options.riverDensity)(rng))
+        {
+            placeLine(Terrain::River);
+        }
+        std::discrete_distribution<int> landTerrain(options.terrainWeights.begin(), options.terrainWeights.end());
+        for (char &edge : edges)
+        {
+            if (edge == ' ')
+            {
+                edge = TERRAIN_CHARS[landTerrain(rng)];
+            }
+        }
+        return edges;
+    }
+
+    std::string getTaskTerrains(const std::string &edges)
+    {
+        std::string taskTerrains;
+        for (char edge : edges)
+        {
+            if (edge != TERRAIN_CHARS[static_cast<int>(Terrain::Grass)])
+            {
+                taskTerrains.push_back(edge);
+            }
+        }
+        return taskTerrains;
+    }
+}
+
+YAML::Node generateTileset(const TilesetOptions &options)
+{
+    validate(options);
+    std::mt19937 rng(options.seed);
+    const int taskTiles = std::lround(options.tiles * options.taskTileShare);
+    YAML::Node rootNode;
+    for (int i = 0; i < options.tiles; i++)
+    {
+        YAML::Node tile;
+        std::string edges = generateEdges(options, rng);
+        if (i >= taskTiles)
+        {
+            tile["edges"] = edges;
+            rootNode["tiles"].push_back(tile);
+            continue;
+        }
+        // The task is about one of the terrains on the tile, and there are no Grass tasks.
+        std::string taskTerrains = getTaskTerrains(edges);
+        while (taskTerrains.empty())
+        {
+            edges = generateEdges(options, rng);
+            taskTerrains = getTaskTerrains(edges);
+        }
+        const std::string task(1, taskTerrains[std::uniform_int_distribution<int>(0, taskTerrains.size() - 1)(rng)]);
+        tile["edges"] = edges;
+        tile["task"] = task;
+        rootNode["tiles"].push_back(tile);
+        YAML::Node taskSize;
+        taskSize[task] = std::uniform_int_distribution<int>(MIN_TASK_SIZE, MAX_TASK_SIZE)(rng);
+        rootNode["tasks"].push_back(taskSize);
+    }
+    return rootNode;
+}
@@ -0,0 +1,453 @@
+#include "training_data.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+
+namespace
+{
+    const char FILE_MAGIC[8] = {'D', 'O', 'R', 'F', 'T', 'R', 'N', '1'};
+    constexpr std::uint32_t FORMAT_VERSION = 1;
+    constexpr std::uint32_t CHUNK_MAGIC = 0x4b4e4843; // "CHNK"
+    constexpr std::uint32_t COLUMNS = 6;
+    // Bytes per sample in each column, in the order of packColumns.
+    constexpr std::uint64_t COLUMN_WIDTHS[COLUMNS] = {sizeof(std::uint32_t), sizeof(std::uint16_t), sizeof(std::uint8_t),
+                                                      sizeof(std::int16_t), FEATURE_PLANES_SIZE * sizeof(std::uint8_t),
+                                                      TASK_STATE_SIZE * sizeof(std::int16_t)};
+    constexpr std::size_t MAX_LITERAL = 128;
+    constexpr std::size_t MAX_RUN = 128;
+
+    void putU32(std::vector<char> &out, std::uint32_t value)
+    {
+        for (int b = 0; b < 4; b++)
+        {
+            out.push_back(static_cast<char>((value >> (8 * b)) & 0xff));
+        }
+    }
+
+    std::uint32_t getU32(const char *in)
+    {
+        std::uint32_t value = 0;
+        for (int b = 0; b < 4; b++)
+        {
+            value |= static_cast<std::uint32_t>(static_cast<unsigned char>(in[b])) << (8 * b);
+        }
+        return value;
+    }
+
+    // PackBits: a control byte c < 128 is followed by c + 1 literal bytes, c > 128 means the next byte repeated 257 - c times.
+    auto packBits(const std::vector<std::uint8_t> &in) -> std::vector<char>
+    {
+        std::vector<char> out;
+        std::size_t i = 0;
+        while (i < in.size())
+        {
+            std::size_t run = 1;
+            while (i + run < in.size() && run < MAX_RUN && in[i + run] == in[i])
+            {
+                run++;
+            }
+            if (run >= 2)
+            {
+                out.push_back(static_cast<char>(257 - run));
+                out.push_back(static_cast<char>(in[i]));
+                i += run;
+                continue;
+            }
+            std::size_t start = i++;
+            while (i < in.size() && i - start < MAX_LITERAL && !(i + 1 < in.size() && in[i] == in[i + 1]))
+            {
+                i++;
+            }
+            out.push_back(static_cast<char>(i - start - 1));
+            out.insert(out.end(), in.begin() + start, in.begin() + i);
+        }
+        return out;
+    }
+
+    auto unpackBits(const char *in, std::size_t size, std::size_t rawSize) -> std::vector<std::uint8_t>
+    {
+        std::vector<std::uint8_t> out;
+        out.reserve(rawSize);
+        std::size_t i = 0;
+        while (i < size)
+        {
+            auto control = static_cast<unsigned char>(in[i++]);
+            if (control < 128)
+            {
+                std::size_t count = control + 1;
+                if (i + count > size)
+                {
+                    throw std::runtime_error("corrupted training data: literal past the end of a column");
+                }
+                out.insert(out.end(), in + i, in + i + count);
+                i += count;
+            }
+            else if (control > 128)
+            {
+                if (i >= size)
+                {
+                    throw std::runtime_error("corrupted training data: run past the end of a column");
+                }
+                out.insert(out.end(), 257 - control, static_cast<std::uint8_t>(in[i++]));
+            }
+        }
+        if (out.size() != rawSize)
+        {
+            throw std::runtime_error("corrupted training data: unexpected column size");
+        }
+        return out;
+    }
+
+    // Columns are laid out [element][byte][sample], so that equal high bytes and similar values of one
+    // feature across samples end up next to each other.
+    template <class T, std::size_t N, class GetValues>
+    auto packColumn(const std::vector<TrainingSample> &samples, GetValues getValues) -> std::vector<std::uint8_t>
+    {
+        using Unsigned = std::make_unsigned_t<T>;
+        std::vector<std::uint8_t> raw;
+        raw.reserve(samples.size() * N * sizeof(T));
+        for (std::size_t e = 0; e < N; e++)
+        {
+            for (std::size_t b = 0; b < sizeof(T); b++)
+            {
+                for (const TrainingSample &sample : samples)
+                {
+                    auto value = static_cast<Unsigned>(getValues(sample)[e]);
+                    raw.push_back(static_cast<std::uint8_t>((value >> (8 * b)) & 0xff));
+                }
+            }
+        }
+        return raw;
+    }
+
+    template <class T, std::size_t N, class GetValues>
+    void unpackColumn(const std::vector<std::uint8_t> &raw, std::vector<TrainingSample> &samples, GetValues getValues)
+    {
+        using Unsigned = std::make_unsigned_t<T>;
+        if (raw.size() != samples.size() * N * sizeof(T))
+        {
+            throw std::runtime_error("corrupted training data: column does not match the sample count");
+        }
+        std::size_t pos = 0;
+        for (TrainingSample &sample : samples)
+        {
+            for (std::size_t e = 0; e < N; e++)
+            {
+                getValues(sample)[e] = 0;
+            }
+        }
+        for (std::size_t e = 0; e < N; e++)
+        {
+            for (std::size_t b = 0; b < sizeof(T); b++)
+            {
+                for (TrainingSample &sample : samples)
+                {
+                    T &value = getValues(sample)[e];
+                    value = static_cast<T>(static_cast<Unsigned>(value) | (static_cast<Unsigned>(raw[pos++]) << (8 * b)));
+                }
+            }
+        }
+    }
+
+    auto packColumns(const std::vector<TrainingSample> &samples) -> std::vector<std::vector<std::uint8_t>>
+    {
+        std::vector<std::vector<std::uint8_t>> columns;
+        columns.push_back(packColumn<std::uint32_t, 1>(samples, [](const TrainingSample &s)
+                                                       { return &s.gameId; }));
+        columns.push_back(packColumn<std::uint16_t, 1>(samples, [](const TrainingSample &s)
+                                                       { return &s.turn; }));
+        columns.push_back(packColumn<std::uint8_t, 1>(samples, [](const TrainingSample &s)
+                                                      { return &s.chosen; }));
+        columns.push_back(packColumn<std::int16_t, 1>(samples, [](const TrainingSample &s)
+                                                      { return &s.outcome; }));
+        columns.push_back(packColumn<std::uint8_t, FEATURE_PLANES_SIZE>(samples, [](const TrainingSample &s)
+                                                                        { return s.planes.data(); }));
+        columns.push_back(packColumn<std::int16_t, TASK_STATE_SIZE>(samples, [](const TrainingSample &s)
+                                                                    { return s.taskState.data(); }));
+        return columns;
+    }
+
+    void unpackColumns(const std::vector<std::vector<std::uint8_t>> &columns, std::vector<TrainingSample> &samples)
+    {
+        unpackColumn<std::uint32_t, 1>(columns[0], samples, [](TrainingSample &s)
+                                       { return &s.gameId; });
+        unpackColumn<std::uint16_t, 1>(columns[1], samples, [](TrainingSample &s)
+                                       { return &s.turn; });
+        unpackColumn<std::uint8_t, 1>(columns[2], samples, [](TrainingSample &s)
+                                      { return &s.chosen; });
+        unpackColumn<std::int16_t, 1>(columns[3], samples, [](TrainingSample &s)
+                                      { return &s.outcome; });
+        unpackColumn<std::uint8_t, FEATURE_PLANES_SIZE>(columns[4], samples, [](TrainingSample &s)
+                                                        { return s.planes.data(); });
+        unpackColumn<std::int16_t, TASK_STATE_SIZE>(columns[5], samples, [](TrainingSample &s)
+                                                    { return s.taskState.data(); });
+    }
+
+    auto compressChunk(const std::vector<TrainingSample> &samples) -> std::vector<char>
+    {
+        std::vector<std::vector<std::uint8_t>> columns = packColumns(samples);
+        std::vector<std::vector<char>> compressed;
+        for (const auto &column : columns)
+        {
+            compressed.push_back(packBits(column));
+        }
+        std::vector<char> chunk;
+        putU32(chunk, CHUNK_MAGIC);
+        putU32(chunk, static_cast<std::uint32_t>(samples.size()));
+        putU32(chunk, COLUMNS);
+        for (std::size_t c = 0; c < columns.size(); c++)
+        {
+            putU32(chunk, static_cast<std::uint32_t>(columns[c].size()));
+            putU32(chunk, static_cast<std::uint32_t>(compressed[c].size()));
+        }
+        for (const auto &column : compressed)
+        {
+            chunk.insert(chunk.end(), column.begin(), column.end());
+        }
+        return chunk;
+    }
+}
+
+TrainingDataWriter::TrainingDataWriter(const std::string &path, std::size_t samplesPerChunk, int threads)
+    : m_out(path, std::ios::binary | std::ios::trunc), m_samplesPerChunk(samplesPerChunk)
+{
+    if (!m_out)
+    {
+        throw std::runtime_error("cannot open training data file for writing: " + path);
+    }
+    if (samplesPerChunk == 0 || threads <= 0)
+    {
+        throw std::runtime_error("TrainingDataWriter needs a positive chunk size and thread count");
+    }
+    std::vector<char> header(FILE_MAGIC, FILE_MAGIC + sizeof(FILE_MAGIC));
+    putU32(header, FORMAT_VERSION);
+    putU32(header, FEATURE_PLANES_SIZE);
+    putU32(header, TASK_STATE_SIZE);
+    m_out.write(header.data(), header.size());
+    m_current.reserve(m_samplesPerChunk);
+    for (int i = 0; i < threads; i++)
+    {
+        m_threads.emplace_back(&TrainingDataWriter::compressLoop, this);
+    }
+}
+
+TrainingDataWriter::~TrainingDataWriter()
+{
+    try
+    {
+        close();
+    }
+    catch (...)
+    {
+        // Call close() explicitly to get the errors.
+    }
+}
+
+void TrainingDataWriter::append(const TrainingSample &sample)
+{
+    if (m_closed)
+    {
+        throw std::runtime_error("append() was called on a closed TrainingDataWriter");
+    }
+    m_current.push_back(sample);
+    if (m_current.size() >= m_samplesPerChunk)
+    {
+        enqueueCurrentChunk();
+    }
+}
+
+void TrainingDataWriter::close()
+{
+    if (m_closed)
+    {
+        return;
+    }
+    m_closed = true;
+    if (!m_current.empty())
+    {
+        enqueueCurrentChunk();
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_queueChanged.notify_all();
+    for (std::thread &thread : m_threads)
+    {
+        thread.join();
+    }
+    m_out.close();
+    rethrowBackgroundError();
+}
+
+void TrainingDataWriter::enqueueCurrentChunk()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_queueChanged.wait(lock, [this]
+                        { return m_queue.size() < 2 * m_threads.size() || m_error; });
+    if (m_error)
+    {
+        lock.unlock();
+        rethrowBackgroundError();
+    }
+    m_queue.push_back(PendingChunk{m_nextSequence++, std::move(m_current)});
+    lock.unlock();
+    m_queueChanged.notify_all();
+    m_current.clear();
+    m_current.reserve(m_samplesPerChunk);
+}
+
+void TrainingDataWriter::compressLoop()
+{
+    while (true)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_queueChanged.wait(lock, [this]
+                            { return !m_queue.empty() || m_stopping; });
+        if (m_queue.empty() || m_error)
+        {
+            return;
+        }
+        PendingChunk chunk = std::move(m_queue.front());
+        m_queue.pop_front();
+        lock.unlock();
+        m_queueChanged.notify_all();
+
+        try
+        {
+            std::vector<char> compressed = compressChunk(chunk.samples);
+            lock.lock();
+            m_compressed.emplace(chunk.sequence, std::move(compressed));
+            // Chunks are written in the order they were appended, whichever thread compressed them.
+            while (!m_compressed.empty() && m_compressed.begin()->first == m_nextSequenceToWrite)
+            {
+                const std::vector<char> &bytes = m_compressed.begin()->second;
+                m_out.write(bytes.data(), bytes.size());
+                m_compressed.erase(m_compressed.begin());
+                m_nextSequenceToWrite++;
+            }
+            if (!m_out)
+            {
+                throw std::runtime_error("failed to write a training data chunk");
+            }
+        }
+        catch (...)
+        {
+            if (!lock.owns_lock())
+            {
+                lock.lock();
+            }
+            m_error = std::current_exception();
+            lock.unlock();
+            m_queueChanged.notify_all();
+            return;
+        }
+    }
+}
+
+void TrainingDataWriter::rethrowBackgroundError()
+{
+    std::exception_ptr error;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        error = m_error;
+    }
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+}
+
+TrainingDataReader::TrainingDataReader(const std::string &path)
+    : m_in(path, std::ios::binary)
+{
+    if (!m_in)
+    {
+        throw std::runtime_error("cannot open training data file: " + path);
+    }
+    char header[sizeof(FILE_MAGIC) + 12];
+    if (!m_in.read(header, sizeof(header)) || !std::equal(FILE_MAGIC, FILE_MAGIC + sizeof(FILE_MAGIC), header))
+    {
+        throw std::runtime_error("not a training data file: " + path);
+    }
+    const char *fields = header + sizeof(FILE_MAGIC);
+    if (getU32(fields) != FORMAT_VERSION)
+    {
+        throw std::runtime_error("unsupported training data version in " + path);
+    }
+    if (getU32(fields + 4) != FEATURE_PLANES_SIZE || getU32(fields + 8) != TASK_STATE_SIZE)
+    {
+        throw std::runtime_error("training data in " + path + " was written with a different feature layout");
+    }
+}
+
+bool TrainingDataReader::next(TrainingSample &sample)
+{
+    while (m_nextInChunk >= m_chunk.size())
+    {
+        if (!readChunk())
+        {
+            return false;
+        }
+    }
+    sample = m_chunk[m_nextInChunk++];
+    return true;
+}
+
+bool TrainingDataReader::readChunk()
+{
+    char chunkHeader[12];
+    if (!m_in.read(chunkHeader, sizeof(chunkHeader)))
+    {
+        if (m_in.gcount() == 0)
+        {
+            return false;
+        }
+        throw std::runtime_error("corrupted training data: truncated chunk header");
+    }
+    if (getU32(chunkHeader) != CHUNK_MAGIC || getU32(chunkHeader + 8) != COLUMNS)
+    {
+        throw std::runtime_error("corrupted training data: bad chunk header");
+    }
+    const std::uint32_t sampleCount = getU32(chunkHeader + 4);
+
+    std::vector<char> sizes(COLUMNS * 8);
+    if (!m_in.read(sizes.data(), sizes.size()))
+    {
+        throw std::runtime_error("corrupted training data: truncated column sizes");
+    }
+    // Check the sizes against each other before allocating anything, so that a corrupted header cannot make the
+    // reader allocate more than a chunk of the stated size needs.
+    for (std::uint32_t c = 0; c < COLUMNS; c++)
+    {
+        const std::uint64_t rawSize = getU32(sizes.data() + 8 * c);
+        const std::uint64_t compressedSize = getU32(sizes.data() + 8 * c + 4);
+        if (rawSize != sampleCount * COLUMN_WIDTHS[c])
+        {
+            throw std::runtime_error("corrupted training data: column size does not match the sample count");
+        }
+        // The worst case of packBits is a 1-byte literal between 2-byte runs, 4 bytes for every 3.
+        if (compressedSize > rawSize + (rawSize + 2) / 3 + 1)
+        {
+            throw std::runtime_error("corrupted training data: compressed column is larger than possible");
+        }
+    }
+    std::vector<std::vector<std::uint8_t>> columns;
+    std::vector<char> compressed;
+    for (std::uint32_t c = 0; c < COLUMNS; c++)
+    {
+        const std::uint32_t rawSize = getU32(sizes.data() + 8 * c);
+        const std::uint32_t compressedSize = getU32(sizes.data() + 8 * c + 4);
+        compressed.resize(compressedSize);
+        if (!m_in.read(compressed.data(), compressedSize))
+        {
+            throw std::runtime_error("corrupted training data: truncated column");
+        }
+        columns.push_back(unpackBits(compressed.data(), compressedSize, rawSize));
+    }
+    m_chunk.assign(sampleCount, TrainingSample{});
+    unpackColumns(columns, m_chunk);
+    m_nextInChunk = 0;
+    return true;
+}
@@ -0,0 +1,68 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "yaml-cpp/yaml.h"
+
+#include "batch_playout.h"
+#include "game.h"
+#include "random.h"
+
+TEST_CASE("BatchPlayoutFindsTheLegalMovesOfEachGame")
+{
+    YAML::Node rootNode = YAML::LoadFile(TILES_YAML);
+    setSeed(2);
+    Game game = Game::fromYaml(rootNode);
+    BatchPlayout batch(game, 13, 7); // not a whole number of vector lanes
+    std::vector<std::uint64_t> fitting;
+    while (batch.drawNextTiles())
+    {
+        for (int k = 0; k < batch.getGamesCount(); k++)
+        {
+            const Playout &playout = batch.getGame(k);
+            if (!playout.hasDrawnTile() || playout.getPlacedTilesCount() == 0)
+            {
+                continue;
+            }
+            int legalMoves = 0;
+            for (int index = 0; index < playout.getFrontierSize(); index++)
+            {
+                for (int rotation = 0; rotation < Tile::ROTATIONS; rotation++)
+                {
+                    batch.getFittingGames(index, rotation, fitting);
+                    const bool fits = (fitting[k / 64] >> (k % 64)) & 1;
+                    if (!playout.isDrawnTileTask())
+                    {
+                        REQUIRE(fits == playout.isLegalAtFrontier(index, rotation));
+                    }
+                    legalMoves += fits && (!playout.isDrawnTileTask() || playout.isLegalAtFrontier(index, rotation));
+                }
+            }
+            REQUIRE(legalMoves == playout.countLegalMoves());
+        }
+        batch.getFittingGames(0, 0, fitting);
+        REQUIRE((fitting.back() >> 13) == 0); // padding lanes
+        batch.playDrawnTiles();
+    }
+    for (int k = 0; k < batch.getGamesCount(); k++)
+    {
+        REQUIRE(!batch.isRunning(k));
+        REQUIRE(batch.getGame(k).getPlacedTilesCount() <= game.getRemainingTilesCount());
+    }
+}
+
+TEST_CASE("BatchPlayoutKernelsAgree")
+{
+    YAML::Node rootNode = YAML::LoadFile(TILES_YAML);
+    Game game = Game::fromYaml(rootNode);
+    BatchPlayout vectorized(game, 21, 3, true);
+    BatchPlayout scalar(game, 21, 3, false);
+    for (int moves = vectorized.playRandomMoves(); moves > 0; moves = vectorized.playRandomMoves())
+    {
+        REQUIRE(scalar.playRandomMoves() == moves);
+    }
+    REQUIRE(scalar.playRandomMoves() == 0);
+    for (int k = 0; k < vectorized.getGamesCount(); k++)
+    {
+        REQUIRE(vectorized.getGame(k).getPlacedTilesCount() == scalar.getGame(k).getPlacedTilesCount());
+        REQUIRE(vectorized.getGame(k).getFinishedTasksCount() == scalar.getGame(k).getFinishedTasksCount());
+    }
+}
@@ -2,6 +2,10 @@
 
 #include "board.h"
 
+#include <algorithm>
+#include <utility>
+#include <vector>
+
 TEST_CASE("CanAddTwoFirstTiles")
 {
     std::array<Terrain, Tile::ROTATIONS> edges{Terrain::Grass, Terrain::Grass, Terrain::Grass, Terrain::Grass, Terrain::Grass, Terrain::Grass};
@@ -17,4 +21,154 @@ TEST_CASE("CanAddTwoFirstTiles")
     REQUIRE(b.hasTileAt(neighbors[0]));
     REQUIRE(b.getNeighbors(start).size() == 1);
     REQUIRE(b.getNeighbors(neighbors[0]).size() == 1);
-}
\ No newline at end of file
+}
+
+TEST_CASE("NeighborhoodIsSymmetric")
+{
+    for (int x = -3; x <= 3; x++)
+    {
+        for (int y = -3; y <= 3; y++)
+        {
+            const CellId cell{x, y};
+            auto neighbors = Board::getPotentialNeighbors(cell);
+            for (int direction = 0; direction < Tile::ROTATIONS; direction++)
+            {
+                REQUIRE(Board::areNeighbors(neighbors[direction], cell));
+                REQUIRE(Board::getEdge(neighbors[direction], cell).first == (direction + Tile::ROTATIONS / 2) % Tile::ROTATIONS);
+            }
+        }
+    }
+}
+
+TEST_CASE("FrontierSignaturesFollowPlacedTiles")
+{
+    Tile tile{"RWPF_T"};
+    Board b;
+    const CellId start{0, 0};
+    b.putAt(start, tile, 1);
+    REQUIRE(b.getFrontierSize() == 6);
+    auto neighbors = Board::getPotentialNeighbors(start);
+    for (int direction = 0; direction < Tile::ROTATIONS; direction++)
+    {
+        const int opposite = (direction + Tile::ROTATIONS / 2) % Tile::ROTATIONS;
+        const ConstraintSignature signature = b.getSignature(neighbors[direction]);
+        REQUIRE(Board::getSide(signature, opposite) == b.getTileAt(start).getEdgeTowards(direction));
+        REQUIRE(Board::withSide(signature, opposite, Board::FREE_SIDE) == Board::FREE_SIGNATURE);
+    }
+
+    Tile grass{"______"};
+    b.putAt(neighbors[0], grass, 0);
+    REQUIRE(b.getSignature(neighbors[0]) == Board::FREE_SIGNATURE);
+    std::size_t groupedCells = 0;
+    for (const auto &[signature, cells] : b.getFrontierGroups())
+    {
+        for (CellId cell : cells)
+        {
+            REQUIRE(b.getSignature(cell) == signature);
+        }
+        groupedCells += cells.size();
+    }
+    REQUIRE(groupedCells == b.getFrontierSize());
+    REQUIRE(b.getFrontierSize() == 8);
+
+    b.removeAt(neighbors[0]);
+    REQUIRE(b.getFrontierSize() == 6);
+    b.removeAt(start);
+    REQUIRE(b.getFrontierSize() == 0);
+    REQUIRE(b.getFrontierGroups().empty());
+}
+
+TEST_CASE("FrontierGroupsDoNotDependOnTheOrderOfPlacements")
+{
+    const Tile river{"R__R__"}, forest{"FFF___"}, grass{"______"};
+    const std::vector<std::pair<CellId, const Tile *>> placements{
+        {CellId{0, 0}, &river}, {CellId{1, 0}, &forest}, {CellId{0, -1}, &grass}, {CellId{-1, 0}, &forest}, {CellId{1, 1}, &grass}};
+    Board forward, backward;
+    for (const auto &[cell, tile] : placements)
+    {
+        forward.putAt(cell, *tile, 0);
+    }
+    for (auto it = placements.rbegin(); it != placements.rend(); ++it)
+    {
+        backward.putAt(it->first, *it->second, 0);
+    }
+    forward.putAt(CellId{2, 0}, grass, 0);
+    forward.removeAt(CellId{2, 0});
+
+    REQUIRE(forward.getFrontierGroups() == backward.getFrontierGroups());
+    for (const auto &[signature, cells] : forward.getFrontierGroups())
+    {
+        REQUIRE(std::is_sorted(cells.begin(), cells.end()));
+    }
+}
+
+TEST_CASE("SymmetricBoardsShareTheCanonicalHash")
+{
+    for (int symmetry = 0; symmetry < Board::SYMMETRIES; symmetry++)
+    {
+        for (int x = -3; x <= 3; x++)
+        {
+            for (int y = -3; y <= 3; y++)
+            {
+                const CellId cell{x, y};
+                auto neighbors = Board::getPotentialNeighbors(cell);
+                auto transformedNeighbors = Board::getPotentialNeighbors(Board::transformCell(cell, symmetry));
+                for (int direction = 0; direction < Tile::ROTATIONS; direction++)
+                {
+                    REQUIRE(Board::transformCell(neighbors[direction], symmetry) == transformedNeighbors[Board::transformDirection(direction, symmetry)]);
+                }
+            }
+        }
+    }
+
+    const std::vector<Tile> tiles{Tile{"RWPF_T"}, Tile{"R__R__"}, Tile{"WW_FFF"}, Tile{"TPT__R"}, Tile{"______"}};
+    const std::vector<std::pair<CellId, int>> placements{{{0, 0}, 1}, {{0, -1}, 4}, {{1, 0}, 0}, {{-1, 1}, 2}, {{1, 1}, 5}};
+    Board board;
+    for (std::size_t i = 0; i < tiles.size(); i++)
+    {
+        board.putAt(placements[i].first, tiles[i], placements[i].second);
+    }
+    for (int symmetry = 0; symmetry < Board::SYMMETRIES; symmetry++)
+    {
+        // A mirrored tile is a different tile, placed with rotation 0 and the transformed edges.
+        std::vector<Tile> transformedTiles;
+        for (std::size_t i = 0; i < tiles.size(); i++)
+        {
+            transformedTiles.push_back(Tile{Board::transformEdges(board.getTileAt(placements[i].first), symmetry)});
+        }
+        Board transformed;
+        for (std::size_t i = 0; i < tiles.size(); i++)
+        {
+            transformed.putAt(Board::transformCell(placements[i].first, symmetry), transformedTiles[i], 0);
+        }
+        if (symmetry < Tile::ROTATIONS)
+        {
+            REQUIRE(transformed.getCanonicalHash() == board.getCanonicalHash());
+        }
+        else
+        {
+            REQUIRE(transformed.getCanonicalHash() == board.getMirroredCanonicalHash());
+        }
+        REQUIRE(transformed.getSymmetryHash(0) == board.getSymmetryHash(symmetry));
+    }
+    REQUIRE(board.getMirroredCanonicalHash() != board.getCanonicalHash());
+
+    Board other;
+    for (std::size_t i = 0; i < tiles.size(); i++)
+    {
+        other.putAt(placements[i].first, tiles[i], i == 0 ? 2 : placements[i].second);
+    }
+    REQUIRE(other.getCanonicalHash() != board.getCanonicalHash());
+    // A task marker changes the position even when the edges are the same.
+    const Tile land{tiles[0]};
+    const Tile task{Board::transformEdges(PlacedTile{tiles[0], placements[0].first, 0}, 0), Terrain::River};
+    Board withLand, withTask;
+    withLand.putAt(placements[0].first, land, 0);
+    withTask.putAt(placements[0].first, task, 0);
+    REQUIRE(withTask.getCanonicalHash() != withLand.getCanonicalHash());
+    for (std::size_t i = 0; i < tiles.size(); i++)
+    {
+        board.removeAt(placements[i].first);
+    }
+    REQUIRE(board.getCanonicalHash() == 0);
+}
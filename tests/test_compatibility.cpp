@@ -0,0 +1,126 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "yaml-cpp/yaml.h"
+
+#include "compatibility.h"
+#include "game.h"
+
+#include "test_utils.h"
+
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+
+namespace
+{
+    std::vector<Tile> makeCatalog()
+    {
+        std::vector<Tile> catalog{Tile{"F__F__"}, Tile{"R_RW_W"}, Tile{"WWWWWW"}, Tile{"RRRRRR"}, Tile{"PPPFFF"},
+                                  Tile{"_RR_FF"}, Tile{"TTT_TT"}, Tile{"_W__W_"}, Tile{"_WRW_R"}};
+        for (int i = 0; i < static_cast<int>(catalog.size()); i++)
+        {
+            catalog[i].setCatalogIndex(i);
+        }
+        return catalog;
+    }
+}
+
+TEST_CASE("CompatibilityMatrixMatchesTerrainRules")
+{
+    const auto catalog = makeCatalog();
+    const auto matrix = CompatibilityMatrix::build(catalog);
+    for (const Tile &tile : catalog)
+    {
+        for (int direction = 0; direction < Tile::ROTATIONS; direction++)
+        {
+            for (int terrain = 0; terrain < CompatibilityMatrix::TERRAINS; terrain++)
+            {
+                const std::uint8_t rotations = matrix->getRotations(tile.getCatalogIndex(), direction, static_cast<Terrain>(terrain));
+                for (int rotation = 0; rotation < Tile::ROTATIONS; rotation++)
+                {
+                    const Terrain edge = tile.getEdgeAt((direction + Tile::ROTATIONS - rotation) % Tile::ROTATIONS);
+                    REQUIRE(((rotations >> rotation) & 1) == areTerrainsCompatible(edge, static_cast<Terrain>(terrain)));
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("CompatibilityMatrixIntersectsSides")
+{
+    const auto catalog = makeCatalog();
+    const auto matrix = CompatibilityMatrix::build(catalog);
+    std::array<std::optional<Terrain>, Tile::ROTATIONS> sides;
+    sides[0] = Terrain::River;
+    sides[3] = Terrain::River;
+    // The same intersection of the occupied sides as in Game::getFittingRotations.
+    auto hasPlacement = [&matrix, &sides](int tile, int rotation)
+    {
+        std::uint8_t rotations = (1 << Tile::ROTATIONS) - 1;
+        for (int direction = 0; direction < Tile::ROTATIONS; direction++)
+        {
+            if (sides[direction])
+            {
+                rotations &= matrix->getRotations(tile, direction, *sides[direction]);
+            }
+        }
+        return (rotations >> rotation) & 1;
+    };
+    for (int rotation = 0; rotation < Tile::ROTATIONS; rotation++)
+    {
+        REQUIRE(hasPlacement(2, rotation));  // all-river tile fits in any rotation
+        REQUIRE(!hasPlacement(3, rotation)); // all-rail tile never does
+    }
+    REQUIRE(hasPlacement(7, 2)); // straight river, edges 1 and 4 turned to directions 3 and 0
+    REQUIRE(hasPlacement(7, 5));
+    REQUIRE(!hasPlacement(7, 0));
+}
+
+TEST_CASE("CompatibilityMatrixIsCachedByTilesetHash")
+{
+    const std::string yamlPath = tempPath("compatibility_tiles.yaml");
+    const auto catalog = makeCatalog();
+    const std::uint64_t hash = CompatibilityMatrix::hashTileset(catalog);
+    const std::string cachePath = CompatibilityMatrix::getCachePath(yamlPath, hash);
+    std::remove(cachePath.c_str());
+
+    const auto built = CompatibilityMatrix::loadOrBuild(catalog, yamlPath);
+    REQUIRE(!built->isMapped());
+    REQUIRE(std::ifstream(cachePath).good());
+    const auto mapped = CompatibilityMatrix::loadOrBuild(catalog, yamlPath);
+    REQUIRE(mapped->isMapped());
+    REQUIRE(mapped->getTilesetHash() == hash);
+    for (int direction = 0; direction < Tile::ROTATIONS; direction++)
+    {
+        for (int terrain = 0; terrain < CompatibilityMatrix::TERRAINS; terrain++)
+        {
+            for (int w = 0; w < built->getWordsCount(); w++)
+            {
+                REQUIRE(built->getBitset(direction, static_cast<Terrain>(terrain))[w] == mapped->getBitset(direction, static_cast<Terrain>(terrain))[w]);
+            }
+        }
+    }
+
+    auto otherCatalog = makeCatalog();
+    otherCatalog.pop_back();
+    REQUIRE(CompatibilityMatrix::hashTileset(otherCatalog) != hash);
+    REQUIRE(!CompatibilityMatrix::loadOrBuild(otherCatalog, yamlPath)->isMapped());
+    std::remove(cachePath.c_str());
+    std::remove(CompatibilityMatrix::getCachePath(yamlPath, CompatibilityMatrix::hashTileset(otherCatalog)).c_str());
+}
+
+TEST_CASE("GamesShareTheCompatibilityMatrix")
+{
+    const YAML::Node rootNode = YAML::LoadFile(TILES_YAML);
+    const auto compatibility = Game::loadCompatibility(rootNode);
+    const Game first = Game::fromYaml(rootNode, compatibility);
+    const Game second = Game::fromYaml(rootNode, compatibility);
+    REQUIRE(first.getCompatibility() == compatibility.get());
+    REQUIRE(second.getCompatibility() == compatibility.get());
+
+    const YAML::Node otherNode = YAML::Load(R"(tiles:
+        - edges: 'F__F__'
+        - edges: 'R_RW_W'
+    )");
+    REQUIRE_THROWS_AS(Game::fromYaml(otherNode, compatibility, false), std::runtime_error);
+}
@@ -0,0 +1,76 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "yaml-cpp/yaml.h"
+
+#include "farm_protocol.h"
+#include "self_play.h"
+
+#include <stdexcept>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+TEST_CASE("FarmMessagesRoundTripOverASocket")
+{
+    int fds[2];
+    REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+
+    ReplayRecord record;
+    record.seed = 42;
+    record.finishedTasks = 3;
+    record.moves = {ReplayMove{0, 0, 1, 5}, ReplayMove{-3, 7, 5, 0}};
+    writeMessage(fds[0], FarmMessageType::Job, encodeJob(FarmJob{100, 8}));
+    writeMessage(fds[0], FarmMessageType::GameRecord, encodeReplay(record));
+    writeMessage(fds[0], FarmMessageType::Stop);
+    close(fds[0]);
+
+    FarmMessage message;
+    REQUIRE(readMessage(fds[1], message));
+    REQUIRE(message.type == FarmMessageType::Job);
+    const FarmJob job = decodeJob(message.payload);
+    REQUIRE(job.firstSeed == 100);
+    REQUIRE(job.games == 8);
+
+    REQUIRE(readMessage(fds[1], message));
+    REQUIRE(message.type == FarmMessageType::GameRecord);
+    const ReplayRecord decoded = decodeReplay(message.payload);
+    REQUIRE(decoded.seed == 42);
+    REQUIRE(decoded.finishedTasks == 3);
+    REQUIRE(decoded.moves.size() == 2);
+    REQUIRE(decoded.moves[1].x == -3);
+    REQUIRE(decoded.moves[1].y == 7);
+    REQUIRE(decoded.moves[1].rotation == 5);
+    REQUIRE(decoded.moves[0].taskSize == 5);
+
+    REQUIRE(readMessage(fds[1], message));
+    REQUIRE(message.type == FarmMessageType::Stop);
+    REQUIRE(message.payload.empty());
+    REQUIRE(!readMessage(fds[1], message));
+    close(fds[1]);
+
+    std::vector<char> truncated = encodeReplay(record);
+    truncated.pop_back();
+    REQUIRE_THROWS_AS(decodeReplay(truncated), std::runtime_error);
+
+    REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+    REQUIRE(write(fds[0], "abc", 3) == 3);
+    close(fds[0]);
+    REQUIRE_THROWS_AS(readMessage(fds[1], message), std::runtime_error);
+    close(fds[1]);
+}
+
+TEST_CASE("RecordedGamesReplayTheSameWay")
+{
+    YAML::Node rootNode = YAML::LoadFile(TILES_YAML);
+    const ReplayRecord record = playRecordedGame(rootNode, 17);
+    REQUIRE(!record.moves.empty());
+    const ReplayRecord again = playRecordedGame(rootNode, 17);
+    REQUIRE(again.moves.size() == record.moves.size());
+    REQUIRE(again.finishedTasks == record.finishedTasks);
+    REQUIRE(replayGame(rootNode, decodeReplay(encodeReplay(record))) == record.finishedTasks);
+
+    ReplayRecord corrupted = record;
+    corrupted.moves[1].rotation = (corrupted.moves[1].rotation + 1) % Tile::ROTATIONS;
+    corrupted.moves[1].x += 100;
+    REQUIRE_THROWS_AS(replayGame(rootNode, corrupted), std::runtime_error);
+}
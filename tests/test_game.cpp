@@ -3,8 +3,15 @@
 #include "yaml-cpp/yaml.h"
 
 #include "game.h"
+#include "random.h"
 
+#include <algorithm>
+#include <cmath>
 #include <iostream>
+#include <optional>
+#include <set>
+#include <stdexcept>
+#include <tuple>
 
 TEST_CASE("CanReadTwoTiles")
 {
@@ -91,4 +98,239 @@ TEST_CASE("CheckFirstFourMoveTypes")
   std::vector<Move> nextMoves = game.nextMoves();
   REQUIRE(!nextMoves.empty());
   REQUIRE(nextMoves[0].tile->isLand());
-}
\ No newline at end of file
+}
+
+TEST_CASE("GroupedMovesMatchCellByCellChecks")
+{
+  YAML::Node rootNode = YAML::LoadFile(TILES_YAML);
+  setSeed(3);
+  Game game = Game::fromYaml(rootNode);
+
+  for (int turn = 0; turn < 40; turn++)
+  {
+    std::vector<Move> nextMoves = game.nextMoves();
+    if (nextMoves.empty())
+    {
+      break;
+    }
+    std::set<std::tuple<int, int, int>> grouped, cellByCell;
+    for (const Move &move : nextMoves)
+    {
+      grouped.insert({move.position.x, move.position.y, move.rotation});
+    }
+    // Edges are checked against the neighbors directly, not through the frontier signatures which the grouped
+    // moves use; only the rule about unfinishable tasks is left to canPlaceTileAt.
+    const Board &board = game.getBoard();
+    const Tile &tile = *nextMoves[0].tile;
+    for (CellId position : board.getPlacesForNextTile())
+    {
+      for (int rotation = 0; rotation < Tile::ROTATIONS; rotation++)
+      {
+        const PlacedTile placed{tile, position, rotation};
+        bool fits = true;
+        for (int direction = 0; direction < Tile::ROTATIONS; direction++)
+        {
+          if (auto neighbor = board.getNeighbor(position, direction))
+          {
+            fits = fits && areTerrainsCompatible(placed.getEdgeTowards(direction), neighbor->getEdgeTowards((direction + 3) % Tile::ROTATIONS));
+          }
+        }
+        if (fits && (tile.isLand() || game.canPlaceTileAt(tile, position, rotation, nextMoves[0].taskSize)))
+        {
+          cellByCell.insert({position.x, position.y, rotation});
+        }
+      }
+    }
+    REQUIRE(grouped == cellByCell);
+    game.makeMove(nextMoves[getRandom(std::uniform_int_distribution<int>(0, nextMoves.size() - 1))]);
+  }
+}
+
+TEST_CASE("ForcedChanceOutcomesAreTaken")
+{
+  YAML::Node rootNode = YAML::LoadFile(TILES_YAML);
+  setSeed(5);
+  Game game = Game::fromYaml(rootNode);
+
+  for (int turn = 0; turn < 30; turn++)
+  {
+    const std::vector<ChanceOutcome> outcomes = game.getChanceOutcomes();
+    if (outcomes.empty())
+    {
+      break;
+    }
+    double sum = 0;
+    for (const ChanceOutcome &outcome : outcomes)
+    {
+      sum += outcome.probability;
+    }
+    REQUIRE(std::abs(sum - 1.0) < 1e-9);
+
+    const ChanceOutcome &outcome = outcomes[getRandom(std::uniform_int_distribution<int>(0, outcomes.size() - 1))];
+    const int remaining = game.getRemainingCount(outcome.type);
+    const std::size_t freeTaskSizes = game.getFreeTaskSizes().size();
+    std::vector<Move> nextMoves = game.nextMoves(outcome);
+    REQUIRE(game.getRemainingCount(outcome.type) == remaining - 1);
+    REQUIRE(game.getFreeTaskSizes().size() == freeTaskSizes - (outcome.taskSize ? 1 : 0));
+    if (nextMoves.empty())
+    {
+      break;
+    }
+    REQUIRE(nextMoves[0].tile->getCatalogIndex() == outcome.type);
+    REQUIRE(nextMoves[0].taskSize == outcome.taskSize);
+    game.makeMove(nextMoves[getRandom(std::uniform_int_distribution<int>(0, nextMoves.size() - 1))]);
+  }
+
+  // A task tile with a size which is not free fails before the tile or any size is taken.
+  setSeed(5);
+  Game fresh = Game::fromYaml(rootNode);
+  std::optional<ChanceOutcome> taskOutcome;
+  while (!taskOutcome)
+  {
+    for (const ChanceOutcome &outcome : fresh.getChanceOutcomes())
+    {
+      if (outcome.taskSize)
+      {
+        taskOutcome = outcome;
+      }
+    }
+    if (!taskOutcome)
+    {
+      std::vector<Move> moves = fresh.nextMoves();
+      REQUIRE(!moves.empty());
+      fresh.makeMove(moves[0]);
+    }
+  }
+  REQUIRE(fresh.getDrawnTile() == nullptr);
+  const Terrain task = fresh.getCatalog().getType(taskOutcome->type).getTask();
+  int takenSize = 1;
+  auto [beginIt, endIt] = fresh.getFreeTaskSizes().equal_range(task);
+  while (std::any_of(beginIt, endIt, [takenSize](const auto &item)
+                     { return item.second == takenSize; }))
+  {
+    takenSize++;
+  }
+  std::vector<int> remainingCounts;
+  for (int type = 0; type < fresh.getCatalog().getTypesCount(); type++)
+  {
+    remainingCounts.push_back(fresh.getRemainingCount(type));
+  }
+  const auto freeTaskSizes = fresh.getFreeTaskSizes();
+  REQUIRE_THROWS_AS(fresh.nextMoves(ChanceOutcome{taskOutcome->type, takenSize, 1.0}), std::runtime_error);
+  REQUIRE(fresh.getDrawnTile() == nullptr);
+  REQUIRE(fresh.getFreeTaskSizes() == freeTaskSizes);
+  for (int type = 0; type < fresh.getCatalog().getTypesCount(); type++)
+  {
+    REQUIRE(fresh.getRemainingCount(type) == remainingCounts[type]);
+  }
+}
+
+TEST_CASE("GeneratedMovesMatchNextMovesAndStopEarly")
+{
+  YAML::Node rootNode = YAML::LoadFile(TILES_YAML);
+  setSeed(9);
+  Game game = Game::fromYaml(rootNode);
+
+  REQUIRE(game.generateMoves().begin() == game.generateMoves().end()); // nothing drawn yet
+  for (int turn = 0; turn < 30; turn++)
+  {
+    REQUIRE(game.drawNextTile());
+    Tile *drawn = game.getDrawnTile();
+    REQUIRE(game.drawNextTile()); // does not take another tile
+    REQUIRE(game.getDrawnTile() == drawn);
+
+    std::vector<Move> generated;
+    for (const Move &move : game.generateMoves())
+    {
+      generated.push_back(move);
+    }
+    const std::vector<Move> nextMoves = game.nextMoves();
+    REQUIRE(nextMoves.size() == generated.size());
+    for (std::size_t i = 0; i < nextMoves.size(); i++)
+    {
+      REQUIRE(nextMoves[i].tile == drawn);
+      REQUIRE(nextMoves[i].position == generated[i].position);
+      REQUIRE(nextMoves[i].rotation == generated[i].rotation);
+      REQUIRE(nextMoves[i].taskSize == game.getDrawnTaskSize());
+    }
+    if (nextMoves.empty())
+    {
+      break;
+    }
+    auto first = game.generateMoves().begin();
+    REQUIRE(first->position == nextMoves[0].position);
+    REQUIRE(first->rotation == nextMoves[0].rotation);
+    game.makeMove(*first);
+    REQUIRE(game.getDrawnTile() == nullptr);
+  }
+}
+
+TEST_CASE("CopiedGameOwnsItsDrawnTile")
+{
+  YAML::Node rootNode = YAML::LoadFile(TILES_YAML);
+  setSeed(13);
+  Game game = Game::fromYaml(rootNode);
+  for (int turn = 0; turn < 5; turn++)
+  {
+    std::vector<Move> moves = game.nextMoves();
+    REQUIRE(!moves.empty());
+    game.makeMove(moves[0]);
+  }
+  REQUIRE(game.drawNextTile());
+  REQUIRE_THROWS_AS(game.getChanceOutcomes(), std::runtime_error);
+
+  Game copy = game;
+  Tile *drawn = copy.getDrawnTile();
+  const std::vector<Tile> &tiles = drawn->isTask() ? copy.getTasks() : copy.getLands();
+  REQUIRE(drawn >= tiles.data());
+  REQUIRE(drawn < tiles.data() + tiles.size());
+  REQUIRE(drawn != game.getDrawnTile());
+  REQUIRE(drawn->getCatalogIndex() == game.getDrawnTile()->getCatalogIndex());
+
+  const std::vector<Move> moves = copy.nextMoves();
+  REQUIRE(!moves.empty());
+  REQUIRE(moves[0].tile == drawn);
+  copy.makeMove(moves[0]);
+  REQUIRE(copy.getDrawnTile() == nullptr);
+  REQUIRE(game.getDrawnTile() != nullptr);
+  REQUIRE(copy.getBoard().getTileAt(moves[0].position).tile.getCatalogIndex() == drawn->getCatalogIndex());
+}
+
+TEST_CASE("CopiedGameOutlivesTheOriginal")
+{
+  YAML::Node rootNode = YAML::LoadFile(TILES_YAML);
+  setSeed(17);
+  std::optional<Game> game = Game::fromYaml(rootNode);
+  for (int turn = 0; turn < 8; turn++)
+  {
+    std::vector<Move> moves = game->nextMoves();
+    REQUIRE(!moves.empty());
+    game->makeMove(moves[moves.size() / 2]);
+  }
+  const std::vector<Move> originalMoves = game->nextMoves();
+  Game copy = *game;
+  Game assigned;
+  assigned = copy;
+  game.reset();
+
+  for (const Game *played : {&copy, &assigned})
+  {
+    const std::vector<Tile> &lands = played->getLands(), &tasks = played->getTasks();
+    for (const auto &[id, placed] : played->getBoard().getTiles())
+    {
+      const Tile *tile = &placed.tile;
+      REQUIRE(((tile >= lands.data() && tile < lands.data() + lands.size()) || (tile >= tasks.data() && tile < tasks.data() + tasks.size())));
+    }
+  }
+  const std::vector<Move> copiedMoves = copy.nextMoves();
+  REQUIRE(copiedMoves.size() == originalMoves.size());
+  for (std::size_t i = 0; i < copiedMoves.size(); i++)
+  {
+    REQUIRE(copiedMoves[i].position == originalMoves[i].position);
+    REQUIRE(copiedMoves[i].rotation == originalMoves[i].rotation);
+  }
+  for (int turn = 0; turn < 8 && !copy.nextMoves().empty(); turn++)
+  {
+    copy.makeMove(copy.nextMoves().front());
+  }
+}
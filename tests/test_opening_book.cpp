@@ -0,0 +1,143 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "yaml-cpp/yaml.h"
+
+#include "game.h"
+#include "opening_book.h"
+#include "random.h"
+#include "rollout_search.h"
+#include "self_play.h"
+#include "training_data.h"
+
+#include "test_utils.h"
+
+#include <cstdio>
+#include <stdexcept>
+
+namespace
+{
+    const SearchOptions OPTIONS{4, 1};
+
+    // Plays the best searched move for the first plies of the seeded game and saves them as a book.
+    auto buildBook(const YAML::Node &rootNode, unsigned seed, const std::string &path) -> std::vector<std::pair<CellId, int>>
+    {
+        std::vector<BookEntry> entries;
+        std::vector<std::pair<CellId, int>> bookMoves;
+        setSeed(seed);
+        Game game = Game::fromYaml(rootNode);
+        for (int ply = 0; ply < OpeningBook::DEFAULT_DEPTH && game.drawNextTile(); ply++)
+        {
+            const std::vector<MoveStatistics> statistics = searchMoves(game, OPTIONS);
+            REQUIRE(!statistics.empty());
+            REQUIRE(statistics.front().meanScore >= statistics.back().meanScore);
+            const Move &best = statistics.front().move;
+            entries.push_back(OpeningBook::makeEntry(game, best, statistics.front().visits, statistics.front().meanScore));
+            bookMoves.emplace_back(best.position, best.rotation);
+            game.makeMove(best);
+        }
+        OpeningBook::save(path, entries);
+        return bookMoves;
+    }
+
+    // Rotations of a symmetric tile are the same placement, and the book returns any of them.
+    bool placesSameEdges(const PlacedTile &placed, int rotation)
+    {
+        const PlacedTile expected{placed.tile, placed.id, rotation};
+        for (int direction = 0; direction < Tile::ROTATIONS; direction++)
+        {
+            if (placed.getEdgeTowards(direction) != expected.getEdgeTowards(direction))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+TEST_CASE("OpeningBookReturnsStoredMoves")
+{
+    YAML::Node rootNode = YAML::LoadFile(TILES_YAML);
+    const std::string path = tempPath("opening.book");
+    const auto bookMoves = buildBook(rootNode, 21, path);
+    const auto book = OpeningBook::map(path);
+    REQUIRE(book->getEntriesCount() == bookMoves.size());
+
+    setSeed(21);
+    Game replayed = Game::fromYaml(rootNode);
+    for (const auto &[position, rotation] : bookMoves)
+    {
+        REQUIRE(replayed.drawNextTile());
+        bool fromBook = false;
+        const std::optional<Move> move = chooseMove(replayed, book.get(), OPTIONS, &fromBook);
+        REQUIRE(fromBook);
+        REQUIRE(move->position == position);
+        REQUIRE(placesSameEdges(PlacedTile{*move->tile, move->position, move->rotation}, rotation));
+        replayed.makeMove(*move);
+    }
+    REQUIRE(replayed.drawNextTile());
+    REQUIRE(!book->lookup(replayed));
+
+    std::remove(path.c_str());
+    REQUIRE_THROWS_AS(OpeningBook::map(path), std::runtime_error);
+}
+
+TEST_CASE("OpeningBookServesRotatedPositions")
+{
+    YAML::Node rootNode = YAML::LoadFile(TILES_YAML);
+    const std::string path = tempPath("rotated.book");
+    const auto bookMoves = buildBook(rootNode, 22, path);
+    const auto book = OpeningBook::map(path);
+
+    for (int symmetry = 1; symmetry < Tile::ROTATIONS; symmetry++)
+    {
+        // The same tiles, played on the board rotated by the symmetry.
+        setSeed(22);
+        Game rotated = Game::fromYaml(rootNode);
+        for (std::size_t ply = 0; ply < bookMoves.size(); ply++)
+        {
+            const auto &[position, rotation] = bookMoves[ply];
+            REQUIRE(rotated.drawNextTile());
+            const std::optional<Move> move = book->lookup(rotated);
+            REQUIRE(move);
+            const CellId expectedPosition = Board::transformCell(position, symmetry);
+            const int expectedRotation = (rotation + symmetry) % Tile::ROTATIONS;
+            if (ply == 0)
+            {
+                // All rotations of the empty board are the same board, so the book answers with its own orientation.
+                REQUIRE(move->position == expectedPosition);
+                rotated.placeTileAt(*move->tile, expectedPosition, expectedRotation, move->taskSize);
+                continue;
+            }
+            REQUIRE(move->position == expectedPosition);
+            REQUIRE(placesSameEdges(PlacedTile{*move->tile, move->position, move->rotation}, expectedRotation));
+            rotated.makeMove(*move);
+        }
+    }
+    std::remove(path.c_str());
+}
+
+TEST_CASE("SelfPlayFollowsTheOpeningBook")
+{
+    YAML::Node rootNode = YAML::LoadFile(TILES_YAML);
+    const std::string bookPath = tempPath("self_play.book");
+    const auto bookMoves = buildBook(rootNode, 23, bookPath);
+    const auto book = OpeningBook::map(bookPath);
+
+    const std::string dataPath = tempPath("book_self_play.bin");
+    setSeed(23);
+    Game game = Game::fromYaml(rootNode);
+    {
+        TrainingDataWriter writer(dataPath);
+        SelfPlayOptions options;
+        options.book = book.get();
+        playSelfPlayGame(game, 0, writer, options);
+        writer.close();
+    }
+    for (const auto &[position, rotation] : bookMoves)
+    {
+        REQUIRE(game.getBoard().hasTileAt(position));
+        REQUIRE(placesSameEdges(game.getBoard().getTileAt(position), rotation));
+    }
+    std::remove(dataPath.c_str());
+    std::remove(bookPath.c_str());
+}
@@ -0,0 +1,75 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "yaml-cpp/yaml.h"
+
+#include "game.h"
+#include "playout.h"
+#include "random.h"
+
+TEST_CASE("PlayoutEnforcesTheSameRulesAsGame")
+{
+    YAML::Node rootNode = YAML::LoadFile(TILES_YAML);
+    for (unsigned seed = 1; seed <= 5; seed++)
+    {
+        setSeed(seed);
+        Game game = Game::fromYaml(rootNode);
+        Playout playout = Playout::fromGame(game);
+        std::mt19937 rng(seed);
+        for (int turn = 0;; turn++)
+        {
+            if (turn == 15)
+            {
+                playout = Playout::fromGame(game); // also check copying a game in progress
+            }
+            std::optional<Tile *> tile = game.takeNextTileToPlay();
+            std::optional<int> taskSize = tile && (*tile)->isTask() ? std::make_optional(game.fetchTaskSize((*tile)->getTask())) : std::nullopt;
+            REQUIRE(playout.drawNextTile(rng, taskSize) == tile.has_value());
+            if (!tile)
+            {
+                break;
+            }
+            std::vector<Move> moves;
+            for (CellId position : game.getBoard().getPlacesForNextTile())
+            {
+                for (int rotation = 0; rotation < Tile::ROTATIONS; rotation++)
+                {
+                    const bool legal = game.canPlaceTileAt(**tile, position, rotation, taskSize);
+                    REQUIRE(playout.isLegal(position, rotation) == legal);
+                    if (legal)
+                    {
+                        moves.push_back(Move{*tile, position, rotation, taskSize});
+                    }
+                }
+            }
+            REQUIRE(playout.countLegalMoves() == static_cast<int>(moves.size()));
+            if (moves.empty())
+            {
+                break;
+            }
+            const Move &move = moves[getRandom(std::uniform_int_distribution<int>(0, moves.size() - 1))];
+            game.makeMove(move);
+            playout.place(move.position, move.rotation);
+            REQUIRE(playout.getFrontierSize() == static_cast<int>(game.getBoard().getFrontierSize()));
+            REQUIRE(playout.getCurrentTasksCount() == static_cast<int>(game.getCurrentTasks().size()));
+            REQUIRE(playout.getFinishedTasksCount() == static_cast<int>(game.getFinishedTasks().size()));
+        }
+    }
+}
+
+TEST_CASE("PlayoutPlaysRandomGamesToTheEnd")
+{
+    YAML::Node rootNode = YAML::LoadFile(TILES_YAML);
+    Game game = Game::fromYaml(rootNode);
+    const Playout initial = Playout::fromGame(game);
+    std::mt19937 rng(11);
+    for (int i = 0; i < 20; i++)
+    {
+        Playout playout = initial;
+        playout.shuffleRemainingTiles(rng);
+        const int finishedTasks = playout.playToEnd(rng);
+        REQUIRE(finishedTasks <= static_cast<int>(game.getTasks().size()));
+        REQUIRE(playout.getPlacedTilesCount() > Game::MAX_CONCURRENT_TASKS);
+        REQUIRE(playout.getPlacedTilesCount() <= game.getRemainingTilesCount());
+        REQUIRE(!playout.drawNextTile(rng));
+    }
+}
@@ -0,0 +1,78 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "yaml-cpp/yaml.h"
+
+#include "game.h"
+#include "tile_catalog.h"
+
+#include <cmath>
+#include <map>
+
+TEST_CASE("TileCatalogInternsIdenticalTiles")
+{
+    TileCatalog catalog;
+    Tile forestTask{"F__F__"};
+    forestTask.setTask(Terrain::Forest);
+    REQUIRE(catalog.intern(Tile{"F__F__"}) == 0);
+    REQUIRE(catalog.intern(Tile{"R_RW_W"}) == 1);
+    REQUIRE(catalog.intern(Tile{"F__F__"}) == 0);
+    REQUIRE(catalog.intern(forestTask) == 2);
+    REQUIRE(catalog.intern(Tile{"_F__F_"}) == 3); // a rotation is a different type
+    REQUIRE(catalog.getTypesCount() == 4);
+    REQUIRE(catalog.getTilesCount() == 5);
+    REQUIRE(catalog.getCount(0) == 2);
+    REQUIRE(catalog.getCount(2) == 1);
+    REQUIRE(catalog.getType(2).isTask());
+    REQUIRE(catalog.getType(3).getCatalogIndex() == 3);
+}
+
+TEST_CASE("NextTileOutcomesFollowTheBag")
+{
+    const char *yaml = R"(tiles:
+        - edges: 'F__F__'
+        - edges: 'F__F__'
+        - edges: 'F__F__'
+        - edges: 'PPPPPP'
+        - edges: 'R_RW_W'
+        - edges: 'R_RW_W'
+        - edges: 'R_RW_W'
+        - edges: 'R_RW_W'
+        - edges: 'FFFFFF'
+          task: 'F'
+    )";
+    Game game = Game::fromYaml(YAML::Load(yaml));
+    REQUIRE(game.getCatalog().getTypesCount() == 4);
+    REQUIRE(game.getCatalog().getTilesCount() == 9);
+
+    auto outcomes = game.getNextTileOutcomes();
+    REQUIRE(outcomes.size() == 1);
+    REQUIRE(game.getCatalog().getType(outcomes[0].type).isTask());
+    REQUIRE(outcomes[0].probability == 1.0);
+    game.takeNextTileToPlay();
+
+    outcomes = game.getNextTileOutcomes();
+    std::map<int, double> probabilities;
+    for (const TileOutcome &outcome : outcomes)
+    {
+        probabilities[outcome.type] = outcome.probability;
+    }
+    REQUIRE(probabilities.size() == 3);
+    REQUIRE(probabilities[0] == 3.0 / 8);
+    REQUIRE(probabilities[1] == 1.0 / 8);
+    REQUIRE(probabilities[2] == 4.0 / 8);
+
+    // Every drawn land is taken out of the bag, until only the unused lands are left.
+    for (int drawn = 0; drawn < 8 - Game::UNUSED_LANDS; drawn++)
+    {
+        double sum = 0;
+        for (const TileOutcome &outcome : game.getNextTileOutcomes())
+        {
+            sum += outcome.probability;
+        }
+        REQUIRE(std::abs(sum - 1.0) < 1e-9);
+        const Tile *tile = *game.takeNextTileToPlay();
+        REQUIRE(game.getRemainingCount(tile->getCatalogIndex()) < game.getCatalog().getCount(tile->getCatalogIndex()));
+    }
+    REQUIRE(game.getNextTileOutcomes().empty());
+    REQUIRE(!game.takeNextTileToPlay());
+}
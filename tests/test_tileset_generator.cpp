@@ -0,0 +1,44 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "yaml-cpp/yaml.h"
+
+#include "game.h"
+#include "tileset_generator.h"
+
+TEST_CASE("GeneratedTilesetCanBePlayed")
+{
+    TilesetOptions options;
+    options.tiles = 300;
+    options.seed = 5;
+    YAML::Emitter out;
+    out << generateTileset(options);
+    Game game = Game::fromYaml(YAML::Load(out.c_str()));
+    REQUIRE(game.getLands().size() + game.getTasks().size() == 300);
+    REQUIRE(game.getTasks().size() == 30);
+
+    int moves = 0;
+    for (std::vector<Move> nextMoves = game.nextMoves(); !nextMoves.empty(); nextMoves = game.nextMoves())
+    {
+        game.makeMove(nextMoves.back());
+        moves++;
+    }
+    REQUIRE(moves > Game::MAX_CONCURRENT_TASKS);
+}
+
+TEST_CASE("GeneratedTilesetFollowsDensities")
+{
+    TilesetOptions options;
+    options.tiles = 200;
+    options.railDensity = 0;
+    options.riverDensity = 1;
+    options.terrainWeights = {0, 0, 1, 0};
+    const YAML::Node rootNode = generateTileset(options);
+    for (const auto &tile : rootNode["tiles"])
+    {
+        const auto edges = tile["edges"].as<std::string>();
+        REQUIRE(edges.find('R') == std::string::npos);
+        REQUIRE(edges.find('W') != std::string::npos);
+        REQUIRE(edges.find_first_not_of("WF") == std::string::npos);
+    }
+    REQUIRE(rootNode["tasks"].size() == 20);
+}
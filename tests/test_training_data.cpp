@@ -0,0 +1,134 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "yaml-cpp/yaml.h"
+
+#include "game.h"
+#include "random.h"
+#include "self_play.h"
+#include "training_data.h"
+
+#include "test_utils.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+TEST_CASE("TrainingDataRoundTrip")
+{
+    const std::string path = tempPath("roundtrip.bin");
+    const int samplesCount = 1000;
+    {
+        TrainingDataWriter writer(path, 64, 3);
+        for (int i = 0; i < samplesCount; i++)
+        {
+            TrainingSample sample;
+            sample.gameId = i / 100;
+            sample.turn = i % 100;
+            sample.chosen = i % 7 == 0;
+            sample.outcome = -i;
+            sample.planes[i % FEATURE_PLANES_SIZE] = i % 256;
+            sample.taskState[i % TASK_STATE_SIZE] = 1000 - i;
+            writer.append(sample);
+        }
+        writer.close();
+    }
+    TrainingDataReader reader(path);
+    TrainingSample sample;
+    int read = 0;
+    while (reader.next(sample))
+    {
+        REQUIRE(sample.gameId == static_cast<std::uint32_t>(read / 100));
+        REQUIRE(sample.turn == read % 100);
+        REQUIRE(sample.chosen == (read % 7 == 0));
+        REQUIRE(sample.outcome == -read);
+        REQUIRE(sample.planes[read % FEATURE_PLANES_SIZE] == read % 256);
+        REQUIRE(sample.taskState[read % TASK_STATE_SIZE] == 1000 - read);
+        read++;
+    }
+    REQUIRE(read == samplesCount);
+    std::remove(path.c_str());
+}
+
+TEST_CASE("IncompressibleColumnsRoundTrip")
+{
+    // 0, 1, 1, 0, 1, 1, ... packs into a literal between runs of two, the largest output of packBits.
+    const std::string path = tempPath("incompressible.bin");
+    const int samplesCount = 999;
+    {
+        TrainingDataWriter writer(path, 333);
+        for (int i = 0; i < samplesCount; i++)
+        {
+            TrainingSample sample;
+            sample.chosen = i % 3 != 0;
+            writer.append(sample);
+        }
+        writer.close();
+    }
+    TrainingDataReader reader(path);
+    TrainingSample sample;
+    int read = 0;
+    while (reader.next(sample))
+    {
+        REQUIRE(sample.chosen == (read % 3 != 0));
+        read++;
+    }
+    REQUIRE(read == samplesCount);
+    std::remove(path.c_str());
+}
+
+TEST_CASE("CorruptedSampleCountIsRejected")
+{
+    const std::string path = tempPath("corrupted.bin");
+    {
+        TrainingDataWriter writer(path);
+        writer.append(TrainingSample{});
+        writer.close();
+    }
+    std::string bytes;
+    {
+        std::ifstream in(path, std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    // The sample count follows the "CHNK" magic of the chunk header.
+    const std::size_t chunk = bytes.find("CHNK");
+    REQUIRE(chunk != std::string::npos);
+    bytes.replace(chunk + 4, 4, "\xff\xff\xff\x7f");
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(bytes.data(), bytes.size());
+    }
+    TrainingDataReader reader(path);
+    TrainingSample sample;
+    REQUIRE_THROWS_AS(reader.next(sample), std::runtime_error);
+    std::remove(path.c_str());
+}
+
+TEST_CASE("SelfPlayExportsOneChosenMovePerTurn")
+{
+    const std::string path = tempPath("self_play.bin");
+    YAML::Node rootNode = YAML::LoadFile(TILES_YAML);
+    setSeed(7);
+    Game game = Game::fromYaml(rootNode);
+    int outcome = 0;
+    {
+        TrainingDataWriter writer(path);
+        SelfPlayOptions options;
+        options.maxCandidatesPerTurn = 5;
+        outcome = playSelfPlayGame(game, 42, writer, options);
+        writer.close();
+    }
+    TrainingDataReader reader(path);
+    TrainingSample sample;
+    int chosenCount = 0, lastTurn = -1;
+    while (reader.next(sample))
+    {
+        REQUIRE(sample.gameId == 42);
+        REQUIRE(sample.outcome == outcome);
+        chosenCount += sample.chosen;
+        lastTurn = sample.turn;
+    }
+    REQUIRE(chosenCount == lastTurn + 1);
+    REQUIRE(game.getBoard().getTiles().size() == static_cast<std::size_t>(chosenCount));
+    std::remove(path.c_str());
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstdlib>
+#include <string>
+
+// A path for a scratch file in the test's temporary directory, or in the working directory outside of bazel.
+inline std::string tempPath(const std::string &name)
+{
+    const char *dir = std::getenv("TEST_TMPDIR");
+    return std::string(dir ? dir : ".") + "/" + name;
+}
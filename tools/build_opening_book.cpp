@@ -0,0 +1,140 @@
+#include "yaml-cpp/yaml.h"
+
+#include "game.h"
+#include "opening_book.h"
+#include "random.h"
+#include "rollout_search.h"
+
+#include <chrono>
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+    struct Args
+    {
+        std::string tilesYamlPath;
+        std::string outputPath;
+        int games = 0;
+        int depth = OpeningBook::DEFAULT_DEPTH;
+        int rolloutsPerMove = 64;
+        unsigned firstSeed = 0;
+    };
+
+    Args parseArgs(int argc, char **argv)
+    {
+        if (argc < 4 || argc > 7)
+        {
+            std::cout << "Error: did not pass the expected number of args." << std::endl;
+            std::cout << "Usage: " << argv[0] << " path-to-tiles-yaml output-book games [depth] [rollouts-per-move] [first-seed]" << std::endl;
+            std::exit(1);
+        }
+        Args args;
+        args.tilesYamlPath = argv[1];
+        args.outputPath = argv[2];
+        args.games = std::stoi(argv[3]);
+        if (argc > 4)
+        {
+            args.depth = std::stoi(argv[4]);
+        }
+        if (argc > 5)
+        {
+            args.rolloutsPerMove = std::stoi(argv[5]);
+        }
+        if (argc > 6)
+        {
+            args.firstSeed = std::stoul(argv[6]);
+        }
+        return args;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    using Clock = std::chrono::steady_clock;
+    Args args = parseArgs(argc, argv);
+    YAML::Node rootNode = YAML::LoadFile(args.tilesYamlPath);
+    const auto compatibility = Game::loadCompatibility(rootNode, args.tilesYamlPath);
+
+    // Every game starts from its own shuffle of the tiles and follows the book where it already has an entry,
+    // so the book grows along the lines which the search itself prefers.
+    std::unordered_map<std::uint64_t, BookEntry> entries;
+    long long searchedPositions = 0, bookHits = 0;
+    const auto start = Clock::now();
+    for (int i = 0; i < args.games; i++)
+    {
+        const unsigned seed = args.firstSeed + i;
+        setSeed(seed);
+        Game game = Game::fromYaml(rootNode, compatibility);
+        for (int ply = 0; ply < args.depth && game.drawNextTile(); ply++)
+        {
+            const std::uint64_t key = OpeningBook::getPositionKey(game);
+            std::optional<Move> move;
+            if (auto it = entries.find(key); it != entries.end())
+            {
+                move = OpeningBook::findMove(game, it->second);
+                bookHits += move.has_value();
+            }
+            if (!move)
+            {
+                const std::vector<MoveStatistics> statistics = searchMoves(game, SearchOptions{args.rolloutsPerMove, seed});
+                if (statistics.empty())
+                {
+                    break;
+                }
+                const MoveStatistics &best = statistics.front();
+                entries[key] = OpeningBook::makeEntry(game, best.move, best.visits, best.meanScore);
+                move = best.move;
+                searchedPositions++;
+            }
+            game.makeMove(*move);
+        }
+    }
+    std::vector<BookEntry> sorted;
+    for (const auto &[key, entry] : entries)
+    {
+        sorted.push_back(entry);
+    }
+    OpeningBook::save(args.outputPath, sorted);
+    const double buildSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    // Check the written book by replaying its games, and measure chooseMove on their positions, which includes
+    // the position key and finding the legal move of the entry. The copies are made outside of the clock.
+    const auto book = OpeningBook::map(args.outputPath);
+    const std::size_t maxPositions = 10000;
+    std::vector<Game> positions;
+    for (int i = 0; i < args.games && positions.size() < maxPositions; i++)
+    {
+        setSeed(args.firstSeed + i);
+        Game game = Game::fromYaml(rootNode, compatibility);
+        for (int ply = 0; ply < args.depth && positions.size() < maxPositions && game.drawNextTile(); ply++)
+        {
+            const std::optional<Move> move = book->lookup(game);
+            if (!move)
+            {
+                break;
+            }
+            positions.push_back(game);
+            game.makeMove(*move);
+        }
+    }
+    const SearchOptions searchOptions{args.rolloutsPerMove, args.firstSeed};
+    const auto lookupStart = Clock::now();
+    long long found = 0;
+    const int repeats = 100;
+    for (int r = 0; r < repeats; r++)
+    {
+        for (const Game &position : positions)
+        {
+            bool fromBook = false;
+            chooseMove(position, book.get(), searchOptions, &fromBook);
+            found += fromBook;
+        }
+    }
+    const double lookupSeconds = std::chrono::duration<double>(Clock::now() - lookupStart).count();
+    std::cout << "Wrote " << book->getEntriesCount() << " positions to " << args.outputPath << " in " << buildSeconds << " s, "
+              << searchedPositions << " searched, " << bookHits << " reached again through the book. Book move: "
+              << lookupSeconds * 1e6 / std::max(1LL, found) << " us, " << positions.size() << " positions replayed." << std::endl;
+    return 0;
+}
@@ -0,0 +1,80 @@
+#include "yaml-cpp/yaml.h"
+
+#include "game.h"
+#include "opening_book.h"
+#include "random.h"
+#include "self_play.h"
+#include "training_data.h"
+
+#include <iostream>
+
+namespace
+{
+    struct Args
+    {
+        std::string tilesYamlPath;
+        std::string outputPath;
+        int games = 0;
+        unsigned seed = 0;
+        int threads = 2;
+        int rolloutsPerMove = 0; // random moves
+        std::string bookPath;
+    };
+
+    Args parseArgs(int argc, char **argv)
+    {
+        if (argc < 4 || argc > 8)
+        {
+            std::cout << "Error: did not pass the expected number of args." << std::endl;
+            std::cout << "Usage: " << argv[0] << " path-to-tiles-yaml output-file games [seed] [writer-threads] [rollouts-per-move] [opening-book]" << std::endl;
+            std::exit(1);
+        }
+        Args args;
+        args.tilesYamlPath = argv[1];
+        args.outputPath = argv[2];
+        args.games = std::stoi(argv[3]);
+        if (argc > 4)
+        {
+            args.seed = std::stoul(argv[4]);
+        }
+        if (argc > 5)
+        {
+            args.threads = std::stoi(argv[5]);
+        }
+        if (argc > 6)
+        {
+            args.rolloutsPerMove = std::stoi(argv[6]);
+        }
+        if (argc > 7)
+        {
+            args.bookPath = argv[7];
+        }
+        return args;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    Args args = parseArgs(argc, argv);
+    YAML::Node rootNode = YAML::LoadFile(args.tilesYamlPath);
+    const auto compatibility = Game::loadCompatibility(rootNode, args.tilesYamlPath);
+    setSeed(args.seed);
+    SelfPlayOptions options;
+    std::shared_ptr<const OpeningBook> book;
+    if (!args.bookPath.empty())
+    {
+        book = OpeningBook::map(args.bookPath);
+        options.book = book.get();
+    }
+    options.rolloutsPerMove = args.rolloutsPerMove;
+    TrainingDataWriter writer(args.outputPath, TrainingDataWriter::DEFAULT_SAMPLES_PER_CHUNK, args.threads);
+    long long totalOutcome = 0;
+    for (int gameId = 0; gameId < args.games; gameId++)
+    {
+        Game game = Game::fromYaml(rootNode, compatibility);
+        totalOutcome += playSelfPlayGame(game, gameId, writer, options);
+    }
+    writer.close();
+    std::cout << "Exported " << args.games << " games to " << args.outputPath << ", " << totalOutcome << " tasks finished in total." << std::endl;
+    return 0;
+}
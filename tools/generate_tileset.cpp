@@ -0,0 +1,61 @@
+#include "yaml-cpp/yaml.h"
+
+#include "tileset_generator.h"
+
+#include <iostream>
+#include <sstream>
+
+namespace
+{
+    TilesetOptions parseArgs(int argc, char **argv)
+    {
+        if (argc < 2 || argc > 7)
+        {
+            std::cout << "Error: did not pass the expected number of args." << std::endl;
+            std::cout << "Usage: " << argv[0] << " tiles [seed] [rail-density] [river-density] [task-tile-share] [grass,plains,forest,town weights]" << std::endl;
+            std::exit(1);
+        }
+        TilesetOptions options;
+        options.tiles = std::stoi(argv[1]);
+        if (argc > 2)
+        {
+            options.seed = std::stoul(argv[2]);
+        }
+        if (argc > 3)
+        {
+            options.railDensity = std::stod(argv[3]);
+        }
+        if (argc > 4)
+        {
+            options.riverDensity = std::stod(argv[4]);
+        }
+        if (argc > 5)
+        {
+            options.taskTileShare = std::stod(argv[5]);
+        }
+        if (argc > 6)
+        {
+            std::istringstream weights(argv[6]);
+            std::string weight;
+            for (double &terrainWeight : options.terrainWeights)
+            {
+                if (!std::getline(weights, weight, ','))
+                {
+                    std::cout << "Error: expected 4 comma-separated terrain weights." << std::endl;
+                    std::exit(1);
+                }
+                terrainWeight = std::stod(weight);
+            }
+        }
+        return options;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    TilesetOptions options = parseArgs(argc, argv);
+    YAML::Emitter out;
+    out << generateTileset(options);
+    std::cout << out.c_str() << std::endl;
+    return 0;
+}
@@ -0,0 +1,551 @@
+#include "yaml-cpp/yaml.h"
+
+#include "farm_protocol.h"
+#include "game.h"
+#include "self_play.h"
+
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Plays self-play games in worker processes, which the coordinator starts from this same binary. The
+// coordinator hands out seed ranges over a Unix domain socket, writes the replay records it gets back to the
+// output file, and restarts workers which crash, handing their unfinished games to the next worker. Restarts of
+// a slot back off exponentially, and a slot whose workers keep crashing before they take a job stops the farm.
+// The output file is a sequence of GameRecord messages, readable with readMessage() and decodeReplay().
+namespace
+{
+    constexpr std::uint32_t GAMES_PER_JOB = 8;
+    constexpr int MAX_JOB_ATTEMPTS = 3; // a job which crashed this many workers is given up
+    constexpr int MAX_CRASHES_WITHOUT_JOB = 5; // consecutive crashes of a slot's workers before their first job
+    constexpr int POLL_TIMEOUT_MS = 500;
+    constexpr int REAP_POLL_TIMEOUT_MS = 10; // while a worker which closed its socket has not been reaped yet
+    constexpr std::chrono::milliseconds FIRST_RESTART_DELAY{100};
+    constexpr std::chrono::milliseconds MAX_RESTART_DELAY{5000};
+    const char *const WORKER_FLAG = "--worker";
+
+    struct Args
+    {
+        std::string tilesYamlPath;
+        std::string outputPath;
+        std::uint32_t games = 0;
+        int workers = 0;
+        std::uint32_t firstSeed = 0;
+    };
+
+    Args parseArgs(int argc, char **argv)
+    {
+        if (argc < 4 || argc > 6)
+        {
+            std::cout << "Error: did not pass the expected number of args." << std::endl;
+            std::cout << "Usage: " << argv[0] << " path-to-tiles-yaml output-file games [workers] [first-seed]" << std::endl;
+            std::exit(1);
+        }
+        Args args;
+        args.tilesYamlPath = argv[1];
+        args.outputPath = argv[2];
+        args.games = std::stoul(argv[3]);
+        args.workers = argc > 4 ? std::stoi(argv[4]) : static_cast<int>(sysconf(_SC_NPROCESSORS_ONLN));
+        if (argc > 5)
+        {
+            args.firstSeed = std::stoul(argv[5]);
+        }
+        if (args.workers <= 0)
+        {
+            std::cout << "Error: need at least one worker." << std::endl;
+            std::exit(1);
+        }
+        return args;
+    }
+
+    auto makeAddress(const std::string &socketPath) -> sockaddr_un
+    {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if (socketPath.size() >= sizeof(address.sun_path))
+        {
+            throw std::runtime_error("socket path is too long: " + socketPath);
+        }
+        std::strcpy(address.sun_path, socketPath.c_str());
+        return address;
+    }
+
+    int runWorker(const std::string &socketPath, const std::string &tilesYamlPath, std::uint32_t slot)
+    {
+        const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        const sockaddr_un address = makeAddress(socketPath);
+        if (fd < 0 || connect(fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0)
+        {
+            std::cerr << "worker " << slot << ": cannot connect to " << socketPath << ": " << std::strerror(errno) << std::endl;
+            return 1;
+        }
+        const YAML::Node rootNode = YAML::LoadFile(tilesYamlPath);
+        // Mapped from the cache which the coordinator wrote before starting the workers.
+        const auto compatibility = Game::loadCompatibility(rootNode, tilesYamlPath);
+        std::vector<char> hello(sizeof(slot));
+        std::memcpy(hello.data(), &slot, sizeof(slot));
+        writeMessage(fd, FarmMessageType::Hello, hello);
+        FarmMessage message;
+        while (readMessage(fd, message) && message.type == FarmMessageType::Job)
+        {
+            const FarmJob job = decodeJob(message.payload);
+            for (std::uint32_t i = 0; i < job.games; i++)
+            {
+                writeMessage(fd, FarmMessageType::GameRecord, encodeReplay(playRecordedGame(rootNode, job.firstSeed + i, compatibility)));
+            }
+            writeMessage(fd, FarmMessageType::JobDone);
+        }
+        close(fd);
+        return 0;
+    }
+
+    struct QueuedJob
+    {
+        FarmJob job;
+        int attempts = 0;
+    };
+
+    struct Worker
+    {
+        pid_t pid = -1;
+        int fd = -1;
+        std::optional<QueuedJob> job;
+        bool stopped = false;      // Stop was sent, so the worker is expected to exit
+        bool disconnected = false; // its socket was closed, but the process was not reaped yet
+    };
+
+    // Survives the restarts of the worker in a slot.
+    struct SlotHistory
+    {
+        int crashes = 0;             // in a row, reset when a worker of the slot finishes a job
+        int crashesWithoutJob = 0;   // in a row, reset when a worker of the slot is given a job
+        std::optional<std::chrono::steady_clock::time_point> restartAt;
+    };
+
+    class Coordinator
+    {
+    public:
+        Coordinator(const Args &args, std::string socketPath)
+            : m_args(args), m_socketPath(std::move(socketPath)), m_workers(args.workers), m_slots(args.workers)
+        {
+            for (std::uint32_t seed = 0; seed < args.games; seed += GAMES_PER_JOB)
+            {
+                m_jobs.push_back(QueuedJob{FarmJob{args.firstSeed + seed, std::min(GAMES_PER_JOB, args.games - seed)}});
+            }
+            m_recorded.assign(args.games, false);
+            m_outFd = open(args.outputPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+            if (m_outFd < 0)
+            {
+                throw std::runtime_error("cannot open " + args.outputPath);
+            }
+            m_listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            const sockaddr_un address = makeAddress(m_socketPath);
+            if (m_listenFd < 0 || bind(m_listenFd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0 ||
+                listen(m_listenFd, args.workers) != 0)
+            {
+                throw std::runtime_error("cannot listen on " + m_socketPath + ": " + std::strerror(errno));
+            }
+        }
+
+        ~Coordinator()
+        {
+            // Only left running when run() throws.
+            for (Worker &worker : m_workers)
+            {
+                if (worker.pid > 0)
+                {
+                    kill(worker.pid, SIGKILL);
+                    waitpid(worker.pid, nullptr, 0);
+                }
+                if (worker.fd >= 0)
+                {
+                    close(worker.fd);
+                }
+            }
+            for (int fd : m_unidentifiedFds)
+            {
+                close(fd);
+            }
+            close(m_listenFd);
+            close(m_outFd);
+            unlink(m_socketPath.c_str());
+        }
+
+        void run()
+        {
+            for (int slot = 0; slot < static_cast<int>(m_workers.size()); slot++)
+            {
+                spawn(slot);
+            }
+            while (std::any_of(m_workers.begin(), m_workers.end(), [](const Worker &worker)
+                               { return worker.pid > 0; }) ||
+                   std::any_of(m_slots.begin(), m_slots.end(), [](const SlotHistory &slot)
+                               { return slot.restartAt.has_value(); }))
+            {
+                pollOnce();
+                reapExitedWorkers();
+                restartDueWorkers();
+            }
+        }
+
+        void report(double seconds) const
+        {
+            const long long games = m_gamesRecorded;
+            std::cout << "Recorded " << games << " games to " << m_args.outputPath << " in " << seconds << " s ("
+                      << games / seconds << " games/s), " << static_cast<double>(m_finishedTasks) / std::max(1LL, games)
+                      << " finished tasks/game, " << m_restarts << " worker restarts (" << m_crashesWithoutJob
+                      << " before taking a job), " << m_gamesGivenUp << " games given up." << std::endl;
+        }
+
+    private:
+        const Args &m_args;
+        std::string m_socketPath;
+        std::vector<Worker> m_workers;
+        std::vector<SlotHistory> m_slots;
+        std::deque<QueuedJob> m_jobs;
+        std::vector<bool> m_recorded; // by seed - firstSeed
+        std::vector<int> m_unidentifiedFds; // accepted, but no Hello yet
+        int m_listenFd = -1;
+        int m_outFd = -1;
+        long long m_gamesRecorded = 0;
+        long long m_finishedTasks = 0;
+        long long m_gamesGivenUp = 0;
+        int m_restarts = 0;
+        int m_crashesWithoutJob = 0;
+
+        void spawn(int slot)
+        {
+            const pid_t pid = fork();
+            if (pid < 0)
+            {
+                throw std::runtime_error(std::string("cannot start a worker: ") + std::strerror(errno));
+            }
+            if (pid == 0)
+            {
+                const std::string slotArg = std::to_string(slot);
+                execl("/proc/self/exe", "selfplay_farm", WORKER_FLAG, m_socketPath.c_str(), m_args.tilesYamlPath.c_str(), slotArg.c_str(), nullptr);
+                _exit(127);
+            }
+            m_workers[slot] = Worker{};
+            m_workers[slot].pid = pid;
+        }
+
+        void pollOnce()
+        {
+            std::vector<pollfd> fds{pollfd{m_listenFd, POLLIN, 0}};
+            for (int fd : m_unidentifiedFds)
+            {
+                fds.push_back(pollfd{fd, POLLIN, 0});
+            }
+            for (const Worker &worker : m_workers)
+            {
+                if (worker.fd >= 0)
+                {
+                    fds.push_back(pollfd{worker.fd, POLLIN, 0});
+                }
+            }
+            if (poll(fds.data(), fds.size(), getPollTimeout()) <= 0)
+            {
+                return;
+            }
+            if (fds[0].revents & POLLIN)
+            {
+                const int fd = accept4(m_listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+                if (fd >= 0)
+                {
+                    m_unidentifiedFds.push_back(fd);
+                }
+            }
+            for (std::size_t i = 1; i < fds.size(); i++)
+            {
+                if (fds[i].revents & (POLLIN | POLLHUP | POLLERR))
+                {
+                    handleReadable(fds[i].fd);
+                }
+            }
+        }
+
+        int getPollTimeout() const
+        {
+            int timeout = POLL_TIMEOUT_MS;
+            for (const Worker &worker : m_workers)
+            {
+                if (worker.pid > 0 && worker.disconnected)
+                {
+                    timeout = std::min(timeout, REAP_POLL_TIMEOUT_MS);
+                }
+            }
+            const auto now = std::chrono::steady_clock::now();
+            for (const SlotHistory &slot : m_slots)
+            {
+                if (slot.restartAt)
+                {
+                    const auto wait = std::chrono::ceil<std::chrono::milliseconds>(*slot.restartAt - now).count();
+                    timeout = std::min<int>(timeout, std::max<long long>(0, wait));
+                }
+            }
+            return timeout;
+        }
+
+        void handleReadable(int fd)
+        {
+            FarmMessage message;
+            bool received;
+            try
+            {
+                received = readMessage(fd, message);
+            }
+            catch (const std::runtime_error &)
+            {
+                received = false; // a worker which died in the middle of a message
+            }
+            auto unidentified = std::find(m_unidentifiedFds.begin(), m_unidentifiedFds.end(), fd);
+            if (unidentified != m_unidentifiedFds.end())
+            {
+                m_unidentifiedFds.erase(unidentified);
+                std::uint32_t slot;
+                if (!received || message.type != FarmMessageType::Hello || message.payload.size() != sizeof(slot))
+                {
+                    close(fd);
+                    return;
+                }
+                std::memcpy(&slot, message.payload.data(), sizeof(slot));
+                if (slot >= m_workers.size() || m_workers[slot].fd >= 0)
+                {
+                    close(fd);
+                    return;
+                }
+                m_workers[slot].fd = fd;
+                assignJob(m_workers[slot]);
+                return;
+            }
+            Worker &worker = *std::find_if(m_workers.begin(), m_workers.end(), [fd](const Worker &w)
+                                           { return w.fd == fd; });
+            if (!received)
+            {
+                // The worker closed its socket, so it is exiting or already dead. If it has not exited yet,
+                // reapExitedWorkers handles it on one of the next short polls.
+                close(worker.fd);
+                worker.fd = -1;
+                worker.disconnected = true;
+                int status = 0;
+                if (waitpid(worker.pid, &status, WNOHANG) == worker.pid)
+                {
+                    handleExit(&worker - m_workers.data(), status);
+                }
+                return;
+            }
+            if (message.type == FarmMessageType::GameRecord)
+            {
+                record(message.payload);
+            }
+            else if (message.type == FarmMessageType::JobDone)
+            {
+                m_slots[&worker - m_workers.data()].crashes = 0;
+                worker.job.reset();
+                assignJob(worker);
+            }
+        }
+
+        void record(const std::vector<char> &payload)
+        {
+            const ReplayRecord replay = decodeReplay(payload);
+            const std::uint32_t index = replay.seed - m_args.firstSeed;
+            if (index >= m_recorded.size() || m_recorded[index])
+            {
+                return; // a game replayed after a crash
+            }
+            m_recorded[index] = true;
+            writeMessage(m_outFd, FarmMessageType::GameRecord, payload);
+            m_gamesRecorded++;
+            m_finishedTasks += replay.finishedTasks;
+        }
+
+        void assignJob(Worker &worker)
+        {
+            if (m_jobs.empty())
+            {
+                worker.stopped = true;
+                try
+                {
+                    writeMessage(worker.fd, FarmMessageType::Stop);
+                }
+                catch (const std::runtime_error &)
+                {
+                }
+                return;
+            }
+            worker.job = m_jobs.front();
+            m_jobs.pop_front();
+            worker.job->attempts++;
+            m_slots[&worker - m_workers.data()].crashesWithoutJob = 0;
+            try
+            {
+                writeMessage(worker.fd, FarmMessageType::Job, encodeJob(worker.job->job));
+            }
+            catch (const std::runtime_error &)
+            {
+                // The worker died, its job is queued again when it is reaped.
+            }
+        }
+
+        void requeueUnfinished(const QueuedJob &queued)
+        {
+            // Games recorded before the crash are kept; the rest go back to the front of the queue in contiguous runs.
+            for (std::uint32_t i = 0; i < queued.job.games;)
+            {
+                const std::uint32_t seed = queued.job.firstSeed + i;
+                if (m_recorded[seed - m_args.firstSeed])
+                {
+                    i++;
+                    continue;
+                }
+                std::uint32_t games = 1;
+                while (i + games < queued.job.games && !m_recorded[seed + games - m_args.firstSeed])
+                {
+                    games++;
+                }
+                if (queued.attempts >= MAX_JOB_ATTEMPTS)
+                {
+                    std::cerr << "giving up seeds " << seed << ".." << seed + games - 1 << " after " << queued.attempts << " crashed workers" << std::endl;
+                    m_gamesGivenUp += games;
+                }
+                else
+                {
+                    m_jobs.push_front(QueuedJob{FarmJob{seed, games}, queued.attempts});
+                }
+                i += games;
+            }
+        }
+
+        void reapExitedWorkers()
+        {
+            for (int slot = 0; slot < static_cast<int>(m_workers.size()); slot++)
+            {
+                int status = 0;
+                if (m_workers[slot].pid > 0 && waitpid(m_workers[slot].pid, &status, WNOHANG) == m_workers[slot].pid)
+                {
+                    handleExit(slot, status);
+                }
+            }
+        }
+
+        void handleExit(int slot, int status)
+        {
+            Worker &worker = m_workers[slot];
+            if (worker.fd >= 0)
+            {
+                close(worker.fd);
+            }
+            const bool crashed = !worker.stopped || !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+            const bool hadJob = worker.job.has_value();
+            if (worker.job)
+            {
+                requeueUnfinished(*worker.job);
+            }
+            worker = Worker{};
+            SlotHistory &history = m_slots[slot];
+            if (crashed)
+            {
+                history.crashes++;
+                if (!hadJob)
+                {
+                    history.crashesWithoutJob++;
+                    m_crashesWithoutJob++;
+                }
+                std::cerr << "worker " << slot << " " << (WIFSIGNALED(status) ? "was killed by signal " + std::to_string(WTERMSIG(status)) : "exited with status " + std::to_string(WEXITSTATUS(status)))
+                          << (hadJob ? "" : " before taking a job") << std::endl;
+                if (history.crashesWithoutJob >= MAX_CRASHES_WITHOUT_JOB)
+                {
+                    throw std::runtime_error("workers of slot " + std::to_string(slot) + " crashed " + std::to_string(history.crashesWithoutJob) +
+                                             " times in a row before taking a job");
+                }
+            }
+            if (!m_jobs.empty())
+            {
+                // Exponential backoff, so that a worker which keeps crashing does not spin the coordinator.
+                const auto delay = crashed ? std::min(MAX_RESTART_DELAY, FIRST_RESTART_DELAY * (1 << std::min(history.crashes - 1, 16)))
+                                           : std::chrono::milliseconds{0};
+                history.restartAt = std::chrono::steady_clock::now() + delay;
+            }
+        }
+
+        void restartDueWorkers()
+        {
+            const auto now = std::chrono::steady_clock::now();
+            for (int slot = 0; slot < static_cast<int>(m_slots.size()); slot++)
+            {
+                SlotHistory &history = m_slots[slot];
+                if (!history.restartAt || *history.restartAt > now)
+                {
+                    continue;
+                }
+                history.restartAt.reset();
+                // The other workers may have finished the remaining jobs in the meantime.
+                if (!m_jobs.empty())
+                {
+                    m_restarts++;
+                    spawn(slot);
+                }
+            }
+        }
+    };
+}
+
+int main(int argc, char **argv)
+{
+    if (argc == 5 && std::string(argv[1]) == WORKER_FLAG)
+    {
+        return runWorker(argv[2], argv[3], std::stoul(argv[4]));
+    }
+    Args args = parseArgs(argc, argv);
+    // Fail here rather than in every worker, and leave the compatibility cache for the workers to map.
+    try
+    {
+        const YAML::Node rootNode = YAML::LoadFile(args.tilesYamlPath);
+        Game::fromYaml(rootNode, Game::loadCompatibility(rootNode, args.tilesYamlPath), false);
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Error: cannot load tiles from " << args.tilesYamlPath << ": " << e.what() << std::endl;
+        return 1;
+    }
+    std::signal(SIGPIPE, SIG_IGN); // a worker dying while we write to it is handled when its socket is read
+
+    const char *tmp = std::getenv("TMPDIR");
+    std::string directory = std::string(tmp ? tmp : "/tmp") + "/selfplay_farm.XXXXXX";
+    if (!mkdtemp(directory.data()))
+    {
+        std::cerr << "cannot create a directory for the socket: " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+    const auto start = std::chrono::steady_clock::now();
+    int exitCode = 0;
+    try
+    {
+        Coordinator coordinator(args, directory + "/socket");
+        coordinator.run();
+        coordinator.report(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+    catch (const std::runtime_error &e)
+    {
+        std::cerr << "Error: " << e.what() << std::endl;
+        exitCode = 1;
+    }
+    rmdir(directory.c_str());
+    return exitCode;
+}